@@ -0,0 +1,59 @@
+/*
+ *  Save benchmark for Simple Bitmap 2.0
+ *
+ *  Times Bitmap24::save of a 7681x4320 frame (the size from the buffered save change, about 100 MB per file)
+ *  and prints the time per save and the throughput.
+ *
+ *  Build and run from the repository root:
+ *      g++ -std=c++17 -O2 -I. bench/save_bench.cpp -o save_bench
+ *      ./save_bench [output file] [number of saves]
+ *
+ *  The default output file is save_bench.bmp in the current directory, write it to a RAM disk (/tmp, /dev/shm)
+ *  to measure the library instead of the disk.
+ */
+
+
+#include "sbtmp2.0_bitmap.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char **argv){
+    const char *filename = argc > 1 ? argv[1] : "save_bench.bmp";
+    int runs = argc > 2 ? std::atoi(argv[2]) : 5;
+    if(runs < 1)
+        runs = 1;
+
+    //some content, so the pixels aren't all zero
+    sbtmp::formats::Bitmap24 img(7681, 4320);
+    for(uint32_t y = 0; y < img.get_height(); y++){
+        for(uint32_t x = 0; x < img.get_width(); x++){
+            img.set_pixel(x, y, sbtmp::color::set_col(x, y, x ^ y, 255));
+        }
+    }
+
+    //the first save creates the file, it isn't counted
+    if(!img.save(filename)){
+        std::printf("could not save %s\n", filename);
+        return 1;
+    }
+
+    double best = 1e30, total = 0;
+    for(int i = 0; i < runs; i++){
+        auto start = std::chrono::steady_clock::now();
+        bool ok = img.save(filename);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if(!ok){
+            std::printf("save %d failed\n", i);
+            return 1;
+        }
+        best = std::min(best, seconds);
+        total += seconds;
+    }
+
+    double megabytes = img.encoded_size() / 1e6;
+    std::printf("7681x4320 Bitmap24 (%.1f MB), %d saves to %s\n", megabytes, runs, filename);
+    std::printf("average %.3f s/save (%.0f MB/s), best %.3f s/save (%.0f MB/s)\n", total / runs, megabytes * runs / total, best, megabytes / best);
+    return 0;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "sbtmp2.0_io.hpp"
+
+namespace sbtmp::formats{
+    //writes a 24 or 32 bit bitmap to a file row by row, without ever holding the whole image in memory
+    //the header is written when the file is opened, after that rows (or bands of rows) can be added
+    //the file layout is exactly the same as the one of Bitmap24 and Bitmap32
+    //
+    //rows are expected in the same byte order as the pixel data of Bitmap24 (BGR) and Bitmap32 (BGRA)
+    class BitmapWriter{
+        public:
+
+        //order in which the rows are handed to the writer
+        enum class row_order{
+            top_down,   //first row is the top of the image (usual order for renderers)
+            bottom_up   //first row is the bottom of the image (order of the rows in the file)
+        };
+
+        BitmapWriter() = default;
+
+        //opens the file and writes the header
+        BitmapWriter(const char * filename, uint32_t set_width, uint32_t set_height, uint16_t set_bits_per_pixel, row_order order = row_order::top_down){
+            open(filename, set_width, set_height, set_bits_per_pixel, order);
+        }
+
+        //a writer owns its file, so it can't be copied
+        BitmapWriter(const BitmapWriter &) = delete;
+        BitmapWriter &operator=(const BitmapWriter &) = delete;
+
+        //finishes the file if the user didn't
+        ~BitmapWriter(){
+            close();
+        }
+
+        //opens the file and writes the header
+        //only 24 and 32 bits per pixel are supported
+        bool open(const char * filename, uint32_t set_width, uint32_t set_height, uint16_t set_bits_per_pixel, row_order order = row_order::top_down){
+            if(out_image.is_open() || set_width == 0 || set_height == 0 || (set_bits_per_pixel != 24 && set_bits_per_pixel != 32))
+                return false;
+
+            btmp_width = set_width;
+            btmp_height = set_height;
+            bits_per_pixel = set_bits_per_pixel;
+            rows_order = order;
+            rows_done = 0;
+            failed = false;
+
+            row_size = (size_t)btmp_width * (bits_per_pixel / 8);
+            file_stride = io::bmp_row_stride(btmp_width, bits_per_pixel);
+            pixel_data_offset = (bits_per_pixel == 32) ? 122 : 54;
+
+            uint64_t file_size = pixel_data_offset + (uint64_t)file_stride * btmp_height;
+            if(file_size > UINT32_MAX) // the BMP header can't describe files this large
+                return false;
+
+            //the padded rows are collected here before they are written, up to a megabyte (but at least one row)
+            //so writing one row at a time doesn't allocate anything
+            staging_size = (std::max(file_stride, std::min(io::write_block_size, file_stride * btmp_height)) + 4095) & ~(size_t)4095;
+            staging = memory::alloc_aligned(staging_size, 4096);
+            if(!staging)
+                return false;
+
+            out_image.open(filename, std::ios::binary);
+            if(!out_image){
+                free_staging();
+                return false;
+            }
+
+            //build the header, same values as used by Bitmap24 and Bitmap32
+            uint8_t header[122] = {0};
+            header[0] = 'B';
+            header[1] = 'M';
+            io::put_le(header + 2, (uint32_t)file_size);
+            io::put_le(header + 10, pixel_data_offset);
+            io::put_le(header + 14, pixel_data_offset - 14); //DIB header size
+            io::put_le(header + 18, btmp_width);
+            io::put_le(header + 22, btmp_height);
+            io::put_le(header + 26, (uint16_t)1); //color planes
+            io::put_le(header + 28, bits_per_pixel);
+            io::put_le(header + 30, (uint32_t)((bits_per_pixel == 32) ? 3 : 0)); //Bl_RGB
+            io::put_le(header + 34, (uint32_t)(file_stride * btmp_height));
+            io::put_le(header + 38, (uint32_t)2835); //DPI_hor
+            io::put_le(header + 42, (uint32_t)2835); //DPI_ver
+            if(bits_per_pixel == 32){
+                //channel bit masks and color space
+                io::put_le(header + 54, (uint32_t)0x00ff0000);
+                io::put_le(header + 58, (uint32_t)0x0000ff00);
+                io::put_le(header + 62, (uint32_t)0x000000ff);
+                io::put_le(header + 66, (uint32_t)0xff000000);
+                memcpy(header + 70, " niW", 4);
+            }
+            out_image.write((char*)header, pixel_data_offset);
+
+            //top down rows are written from the end of the file towards the header,
+            //so the file gets its final size right away
+            if(rows_order == row_order::top_down){
+                out_image.seekp(file_size - 1);
+                out_image.put(0);
+            }
+
+            return out_image.good();
+        }
+
+        //writes a single row
+        bool write_row(const uint8_t * row){
+            return write_rows(row, 1);
+        }
+
+        //writes a band of rows (in the order given to open)
+        //stride is the distance between two rows in memory, 0 means the rows are tightly packed
+        //once a write failed, the file is broken: every further write and close return false
+        bool write_rows(const uint8_t * rows, uint32_t count, size_t stride = 0){
+            if(!out_image.is_open() || failed || !rows || count == 0 || count > btmp_height - rows_done)
+                return false;
+            if(stride == 0)
+                stride = row_size;
+
+            io::stream_sink out(out_image);
+            bool ok;
+            if(rows_order == row_order::bottom_up){
+                //same order as the file, just append
+                ok = io::write_padded_rows(out, rows, row_size, stride, count, staging, staging_size);
+            }
+            else{
+                //the band ends up reversed in the file:
+                //its last row is the lowest one in the file, so we start there and walk the band backwards
+                uint32_t first_file_row = btmp_height - rows_done - count;
+                out_image.seekp(pixel_data_offset + (uint64_t)first_file_row * file_stride);
+                ok = io::write_padded_rows(out, rows + (count - 1) * stride, row_size, -(ptrdiff_t)stride, count, staging, staging_size);
+            }
+
+            //a failed band isn't counted, the next band would end up in its rows otherwise
+            if(ok)
+                rows_done += count;
+            else
+                failed = true;
+            return ok;
+        }
+
+        //finishes the file
+        //returns false if not all rows were written (the missing ones are left black) or if any write failed
+        bool close(){
+            if(!out_image.is_open())
+                return false;
+
+            bool complete = rows_done == btmp_height;
+            if(!complete && !failed && rows_order == row_order::bottom_up){
+                //fill the rest of the file so that the header is still correct
+                memset(staging, 0, file_stride);
+                for(; rows_done < btmp_height; rows_done++){
+                    out_image.write((char*)staging, file_stride);
+                }
+            }
+
+            bool ok = complete && !failed && out_image.good();
+            out_image.close();
+            free_staging();
+            return ok && out_image.good();
+        }
+
+        //number of rows written so far
+        uint32_t get_rows_written(){
+            return rows_done;
+        }
+
+        uint32_t get_width(){
+            return btmp_width;
+        }
+
+        uint32_t get_height(){
+            return btmp_height;
+        }
+
+        private:
+
+        void free_staging(){
+            memory::free_aligned(staging);
+            staging = nullptr;
+            staging_size = 0;
+        }
+
+        std::ofstream out_image;
+
+        uint32_t btmp_width = 0, btmp_height = 0;
+        uint16_t bits_per_pixel = 0;
+        row_order rows_order = row_order::top_down;
+        uint32_t rows_done = 0;
+        bool failed = false; //a write went wrong, see write_rows
+
+        size_t row_size = 0;
+        size_t file_stride = 0;
+        uint32_t pixel_data_offset = 0;
+        uint8_t *staging = nullptr; //block the padded rows are collected in, see open
+        size_t staging_size = 0;
+    };
+}
@@ -0,0 +1,365 @@
+#pragma once
+
+#include "sbtmp2.0_io.hpp"
+
+namespace sbtmp::formats{
+    //binary PBM (P4), 1 bit per pixel (1 = black, 0 = white)
+    //the pixel data is stored exactly like in the file (8 pixels per byte, first pixel in the highest bit,
+    //rows top down and padded to whole bytes), so saving and loading is a single block write/read
+    //colors darker than 50% gray (same gray value as color::blackNwhite) become black, alpha is dropped
+    class PBM final : public sbtmp::base::image{
+        public:
+
+        //constructor
+        PBM(uint32_t set_width, uint32_t set_height) {
+            create(set_width, set_height);
+        }
+
+        //copy constructor
+        //creates a perfect copy of the original image
+        PBM(const PBM &other){
+            copy_from(other);
+        }
+
+        //move constructor, takes over the pixel data of the other image and leaves it empty
+        PBM(PBM &&other) noexcept{
+            move_from(other);
+        }
+
+        PBM &operator=(const PBM &other){
+            if(this != &other){
+                del();
+                copy_from(other);
+            }
+            return *this;
+        }
+
+        PBM &operator=(PBM &&other) noexcept{
+            if(this != &other){
+                del();
+                move_from(other);
+            }
+            return *this;
+        }
+
+        PBM() = default;
+
+        ~PBM(){
+            del();
+        }
+
+        //saves the image with given filename
+        bool save(const char * filename) override {
+            if(!initialized)
+                return false;
+            std::ofstream out_image;
+            out_image.open(filename, std::ios::binary);
+            if(!out_image)
+                return false;
+
+            io::stream_sink out(out_image);
+            bool ok = encode_to(out);
+
+            out_image.close();
+
+            return ok && out_image.good();
+        }
+
+        //loads a binary *.pbm file (P4)
+        bool load(const char * filename) override {
+            if(initialized)
+                return false;
+
+            std::ifstream in_image;
+            in_image.open(filename, std::ios::binary);
+            if(!in_image)
+                return false;
+
+            io::stream_source in(in_image);
+            return decode_from(in);
+        }
+
+        //encodes the image as *.pbm into a memory buffer (the old content of the buffer is replaced)
+        bool encode(std::vector<uint8_t> &buffer) override {
+            if(!initialized)
+                return false;
+            buffer.clear();
+            buffer.reserve(encoded_size());
+            io::buffer_sink out(buffer);
+            return encode_to(out);
+        }
+
+        //encodes the image as *.pbm into a caller supplied buffer
+        //returns the number of bytes written or 0 if the buffer is too small
+        size_t encode(uint8_t *buffer, size_t size) override {
+            if(!initialized || size < encoded_size())
+                return 0;
+            io::buffer_sink out(buffer, size);
+            return encode_to(out) ? out.size() : 0;
+        }
+
+        //number of bytes a *.pbm file of this image has
+        size_t encoded_size() override {
+            return initialized ? io::netpbm_file_size('4', btmp_width, btmp_height) : 0;
+        }
+
+        //loads a *.pbm file from a memory buffer
+        bool decode(const uint8_t *buffer, size_t size) override {
+            if(initialized)
+                return false;
+            io::memory_source in(buffer, size);
+            return decode_from(in);
+        }
+        using base::image::decode;
+
+        //create function (recommended way to init images)
+        //a new image is white
+        void create(uint32_t set_width, uint32_t set_height) override {
+            if(initialized)
+                return;
+
+            row_size = io::netpbm_row_size('4', set_width, 1);
+            raw_data_size = row_size * set_height;
+            pixel_data = get_allocator().allocate(raw_data_size);
+            if(!pixel_data){
+                row_size = 0;
+                raw_data_size = 0;
+                return;
+            }
+
+            btmp_width = set_width;
+            btmp_height = set_height;
+
+            initialized = true;
+        }
+
+        //set pixel at coords x, y to black or white, depending on the brightness of col
+        void set_pixel(int32_t x, int32_t y, color::Color col) override {
+            set_black(x, y, (color::get_red(col) + color::get_green(col) + color::get_blue(col)) / 3 < 128);
+        }
+
+        //get color of pixel at coords x, y
+        color::Color get_pixel(int32_t x, int32_t y) override {
+            return is_black(x, y) ? color::black : color::white;
+        }
+
+        //same as set_pixel and get_pixel, but without checking if the image is initialized and the pixel is inside of it
+        //the graphics and filters templates use these for pixels they already know to be inside the image
+        void set_pixel_unchecked(int32_t x, int32_t y, color::Color col){
+            uint8_t &byte = pixel_data[(size_t)y * row_size + x / 8];
+            uint8_t bit = 0x80 >> (x % 8);
+            byte = ((color::get_red(col) + color::get_green(col) + color::get_blue(col)) / 3 < 128) ? (byte | bit) : (byte & ~bit);
+        }
+        color::Color get_pixel_unchecked(int32_t x, int32_t y){
+            return is_black(x, y) ? color::black : color::white;
+        }
+
+        //sets a pixel to black (true) or white (false) directly
+        void set_black(int32_t x, int32_t y, bool black){
+            if (!initialized || x > btmp_width - 1 || y > btmp_height - 1 || x < 0 || y < 0)
+                return;
+            uint8_t &byte = pixel_data[(size_t)y * row_size + x / 8];
+            uint8_t bit = 0x80 >> (x % 8);
+            byte = black ? (byte | bit) : (byte & ~bit);
+        }
+
+        //returns true if a pixel is black
+        bool is_black(int32_t x, int32_t y){
+            return pixel_data[(size_t)y * row_size + x / 8] & (0x80 >> (x % 8));
+        }
+
+        //return width of the image
+        uint32_t get_width() override {
+            return btmp_width;
+        }
+
+        //returns height of the image
+        uint32_t get_height() override {
+            return btmp_height;
+        }
+
+        //returns size of the raw data array in bytes
+        size_t get_raw_size() override {
+            return raw_data_size;
+        }
+
+        //changes the size of the image
+        void resize(uint32_t width, uint32_t height) override {
+            if(!initialized)
+                return;
+            if(width == btmp_width && height == btmp_height) // args are the same size as image
+                return;
+
+            size_t new_row_size = io::netpbm_row_size('4', width, 1);
+            uint8_t *data = get_allocator().reallocate(pixel_data, raw_data_size, new_row_size * height);
+            if(!data) // not enough memory, keep the old image
+                return;
+            pixel_data = data;
+
+            btmp_width = width;
+            btmp_height = height;
+            row_size = new_row_size;
+            raw_data_size = row_size * btmp_height;
+        }
+
+        //clears the image (makes it white)
+        void clear() override {
+            if(!initialized)
+                return;
+            memset(pixel_data, 0, raw_data_size);
+        }
+
+        //frees the memory of the image and resets all properties
+        void del() override {
+            if(!initialized)
+                return;
+
+            get_allocator().deallocate(pixel_data, raw_data_size);
+            pixel_data = nullptr;
+
+            btmp_width = 0;
+            btmp_height = 0;
+            row_size = 0;
+            raw_data_size = 0;
+
+            initialized = false;
+        }
+
+        //changes where the image gets its pixel memory from (a memory::buffer_pool for example)
+        //only possible while the image is empty, returns false otherwise
+        //the allocator has to live longer than the image
+        bool set_allocator(memory::allocator &alloc){
+            if(initialized)
+                return false;
+            pixel_allocator = &alloc;
+            return true;
+        }
+
+        //returns the allocator of the image (the default allocator if none was set)
+        memory::allocator &get_allocator(){
+            if(!pixel_allocator)
+                pixel_allocator = &memory::get_default_allocator();
+            return *pixel_allocator;
+        }
+
+        bool is_initialized() override {
+            return initialized;
+        }
+
+        //returns the pixel data (1 bit per pixel, rows top down and padded to whole bytes)
+        uint8_t *data() override {
+            return pixel_data;
+        }
+
+        //returns a pointer to row y (y = 0 is the top row)
+        uint8_t *get_row(uint32_t y) override {
+            if(!initialized || y >= btmp_height)
+                return nullptr;
+            return pixel_data + y * row_size;
+        }
+
+        size_t get_row_size() override {
+            return row_size;
+        }
+
+        size_t get_row_stride() override {
+            return row_size;
+        }
+
+        uint8_t get_bytes_per_pixel() override {
+            return 0;
+        }
+
+        base::channel_order get_channel_order() override {
+            return base::channel_order::mono;
+        }
+
+        bool is_bottom_up() override {
+            return false;
+        }
+
+
+        private:
+
+        //writes the whole *.pbm file to a sink, used by save and encode
+        bool encode_to(io::sink &out){
+            return io::write_netpbm_header(out, '4', btmp_width, btmp_height, 1) && out.write(pixel_data, raw_data_size);
+        }
+
+        //reads a *.pbm file from a source, used by load and decode
+        bool decode_from(io::source &in){
+            if(initialized)
+                return false;
+
+            io::netpbm_info info;
+            if(!io::read_netpbm_header(in, info) || info.type != '4' || !io::netpbm_data_fits(in, info))
+                return false;
+
+            size_t new_row_size = io::netpbm_row_size('4', info.width, 1);
+            size_t size = new_row_size * info.height;
+            uint8_t *data = get_allocator().allocate(size);
+            if(!data)
+                return false;
+            if(!io::read_netpbm_data(in, info, data)){
+                get_allocator().deallocate(data, size);
+                return false;
+            }
+
+            btmp_width = info.width;
+            btmp_height = info.height;
+            row_size = new_row_size;
+            raw_data_size = size;
+            pixel_data = data;
+
+            initialized = true;
+
+            return true;
+        }
+
+        //used by the copy constructor and copy assignment, expects this image to be empty
+        void copy_from(const PBM &other){
+            if(!other.initialized)
+                return;
+            //a copy uses the same allocator as the original, unless it already has one
+            if(!pixel_allocator)
+                pixel_allocator = other.pixel_allocator;
+            pixel_data = get_allocator().allocate(other.raw_data_size);
+            if(!pixel_data)
+                return;
+            memcpy(pixel_data, other.pixel_data, other.raw_data_size);
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            row_size = other.row_size;
+            raw_data_size = other.raw_data_size;
+            initialized = true;
+        }
+
+        //used by the move constructor and move assignment, expects this image to be empty
+        void move_from(PBM &other){
+            if(!other.initialized)
+                return;
+            pixel_data = other.pixel_data;
+            pixel_allocator = other.pixel_allocator; //the pixel data has to go back to where it came from
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            row_size = other.row_size;
+            raw_data_size = other.raw_data_size;
+            initialized = true;
+
+            other.pixel_data = nullptr;
+            other.btmp_width = 0;
+            other.btmp_height = 0;
+            other.row_size = 0;
+            other.raw_data_size = 0;
+            other.initialized = false;
+        }
+
+        uint32_t btmp_width = 0, btmp_height = 0;
+        size_t row_size = 0; //bytes per row
+        size_t raw_data_size = 0;
+
+        uint8_t * pixel_data = nullptr;
+        memory::allocator *pixel_allocator = nullptr; //where pixel_data comes from, see get_allocator
+        bool initialized = false;
+    };
+}
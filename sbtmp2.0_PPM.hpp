@@ -0,0 +1,352 @@
+#pragma once
+
+#include "sbtmp2.0_io.hpp"
+
+namespace sbtmp::formats{
+    //binary PPM (P6), 3 bytes per pixel
+    //the pixel data is stored exactly like in the file (RGB, rows top down, no padding),
+    //so saving and loading is a single block write/read
+    //the alpha channel is dropped, PPM doesn't have one
+    class PPM final : public sbtmp::base::image{
+        public:
+
+        //constructor
+        PPM(uint32_t set_width, uint32_t set_height) {
+            create(set_width, set_height);
+        }
+
+        //copy constructor
+        //creates a perfect copy of the original image
+        PPM(const PPM &other){
+            copy_from(other);
+        }
+
+        //move constructor, takes over the pixel data of the other image and leaves it empty
+        PPM(PPM &&other) noexcept{
+            move_from(other);
+        }
+
+        PPM &operator=(const PPM &other){
+            if(this != &other){
+                del();
+                copy_from(other);
+            }
+            return *this;
+        }
+
+        PPM &operator=(PPM &&other) noexcept{
+            if(this != &other){
+                del();
+                move_from(other);
+            }
+            return *this;
+        }
+
+        PPM() = default;
+
+        ~PPM(){
+            del();
+        }
+
+        //saves the image with given filename
+        bool save(const char * filename) override {
+            if(!initialized)
+                return false;
+            std::ofstream out_image;
+            out_image.open(filename, std::ios::binary);
+            if(!out_image)
+                return false;
+
+            io::stream_sink out(out_image);
+            bool ok = encode_to(out);
+
+            out_image.close();
+
+            return ok && out_image.good();
+        }
+
+        //loads a binary *.ppm file (P6), samples with a max value other than 255 are scaled to 8 bits
+        bool load(const char * filename) override {
+            if(initialized)
+                return false;
+
+            std::ifstream in_image;
+            in_image.open(filename, std::ios::binary);
+            if(!in_image)
+                return false;
+
+            io::stream_source in(in_image);
+            return decode_from(in);
+        }
+
+        //encodes the image as *.ppm into a memory buffer (the old content of the buffer is replaced)
+        bool encode(std::vector<uint8_t> &buffer) override {
+            if(!initialized)
+                return false;
+            buffer.clear();
+            buffer.reserve(encoded_size());
+            io::buffer_sink out(buffer);
+            return encode_to(out);
+        }
+
+        //encodes the image as *.ppm into a caller supplied buffer
+        //returns the number of bytes written or 0 if the buffer is too small
+        size_t encode(uint8_t *buffer, size_t size) override {
+            if(!initialized || size < encoded_size())
+                return 0;
+            io::buffer_sink out(buffer, size);
+            return encode_to(out) ? out.size() : 0;
+        }
+
+        //number of bytes a *.ppm file of this image has
+        size_t encoded_size() override {
+            return initialized ? io::netpbm_file_size('6', btmp_width, btmp_height) : 0;
+        }
+
+        //loads a *.ppm file from a memory buffer
+        bool decode(const uint8_t *buffer, size_t size) override {
+            if(initialized)
+                return false;
+            io::memory_source in(buffer, size);
+            return decode_from(in);
+        }
+        using base::image::decode;
+
+        //create function (recommended way to init images)
+        void create(uint32_t set_width, uint32_t set_height) override {
+            if(initialized)
+                return;
+
+            raw_data_size = (size_t)set_width * set_height * 3;
+            pixel_data = get_allocator().allocate(raw_data_size);
+            if(!pixel_data){
+                raw_data_size = 0;
+                return;
+            }
+
+            btmp_width = set_width;
+            btmp_height = set_height;
+
+            initialized = true;
+        }
+
+        //set pixel at coords x, y to rgb value
+        void set_pixel(int32_t x, int32_t y, color::Color col) override {
+            if (!initialized || x > btmp_width - 1 || y > btmp_height - 1 || x < 0 || y < 0)
+                return;
+            size_t index = get_p_index(x, y);
+            pixel_data[index + 0] = color::get_red(col);
+            pixel_data[index + 1] = color::get_green(col);
+            pixel_data[index + 2] = color::get_blue(col);
+        }
+
+        //get color of pixel at coords x, y
+        color::Color get_pixel(int32_t x, int32_t y) override {
+            size_t index = get_p_index(x, y);
+            return color::set_col(pixel_data[index], pixel_data[index + 1], pixel_data[index + 2], 255);
+        }
+
+        //same as set_pixel and get_pixel, but without checking if the image is initialized and the pixel is inside of it
+        //the graphics and filters templates use these for pixels they already know to be inside the image
+        void set_pixel_unchecked(int32_t x, int32_t y, color::Color col){
+            size_t index = get_p_index(x, y);
+            pixel_data[index + 0] = color::get_red(col);
+            pixel_data[index + 1] = color::get_green(col);
+            pixel_data[index + 2] = color::get_blue(col);
+        }
+        color::Color get_pixel_unchecked(int32_t x, int32_t y){
+            size_t index = get_p_index(x, y);
+            return color::set_col(pixel_data[index], pixel_data[index + 1], pixel_data[index + 2], 255);
+        }
+
+        //return width of the image
+        uint32_t get_width() override {
+            return btmp_width;
+        }
+
+        //returns height of the image
+        uint32_t get_height() override {
+            return btmp_height;
+        }
+
+        //returns size of the raw data array in bytes
+        size_t get_raw_size() override {
+            return raw_data_size;
+        }
+
+        //changes the size of the image
+        void resize(uint32_t width, uint32_t height) override {
+            if(!initialized)
+                return;
+            if(width == btmp_width && height == btmp_height) // args are the same size as image
+                return;
+
+            uint8_t *data = get_allocator().reallocate(pixel_data, raw_data_size, (size_t)width * height * 3);
+            if(!data) // not enough memory, keep the old image
+                return;
+            pixel_data = data;
+
+            btmp_width = width;
+            btmp_height = height;
+            raw_data_size = (size_t)btmp_width * btmp_height * 3;
+        }
+
+        //clears the image
+        void clear() override {
+            if(!initialized)
+                return;
+            memset(pixel_data, 0, raw_data_size);
+        }
+
+        //frees the memory of the image and resets all properties
+        void del() override {
+            if(!initialized)
+                return;
+
+            get_allocator().deallocate(pixel_data, raw_data_size);
+            pixel_data = nullptr;
+
+            btmp_width = 0;
+            btmp_height = 0;
+            raw_data_size = 0;
+
+            initialized = false;
+        }
+
+        //changes where the image gets its pixel memory from (a memory::buffer_pool for example)
+        //only possible while the image is empty, returns false otherwise
+        //the allocator has to live longer than the image
+        bool set_allocator(memory::allocator &alloc){
+            if(initialized)
+                return false;
+            pixel_allocator = &alloc;
+            return true;
+        }
+
+        //returns the allocator of the image (the default allocator if none was set)
+        memory::allocator &get_allocator(){
+            if(!pixel_allocator)
+                pixel_allocator = &memory::get_default_allocator();
+            return *pixel_allocator;
+        }
+
+        bool is_initialized() override {
+            return initialized;
+        }
+
+        //returns the pixel data (RGB, rows top down)
+        uint8_t *data() override {
+            return pixel_data;
+        }
+
+        //returns a pointer to row y (y = 0 is the top row)
+        uint8_t *get_row(uint32_t y) override {
+            if(!initialized || y >= btmp_height)
+                return nullptr;
+            return pixel_data + y * (size_t)btmp_width * 3;
+        }
+
+        size_t get_row_size() override {
+            return (size_t)btmp_width * 3;
+        }
+
+        size_t get_row_stride() override {
+            return (size_t)btmp_width * 3;
+        }
+
+        uint8_t get_bytes_per_pixel() override {
+            return 3;
+        }
+
+        base::channel_order get_channel_order() override {
+            return base::channel_order::rgb;
+        }
+
+        bool is_bottom_up() override {
+            return false;
+        }
+
+
+        private:
+
+        //writes the whole *.ppm file to a sink, used by save and encode
+        bool encode_to(io::sink &out){
+            return io::write_netpbm_header(out, '6', btmp_width, btmp_height, 255) && out.write(pixel_data, raw_data_size);
+        }
+
+        //reads a *.ppm file from a source, used by load and decode
+        bool decode_from(io::source &in){
+            if(initialized)
+                return false;
+
+            io::netpbm_info info;
+            if(!io::read_netpbm_header(in, info) || info.type != '6' || !io::netpbm_data_fits(in, info))
+                return false;
+
+            size_t size = (size_t)info.width * info.height * 3;
+            uint8_t *data = get_allocator().allocate(size);
+            if(!data)
+                return false;
+            if(!io::read_netpbm_data(in, info, data)){
+                get_allocator().deallocate(data, size);
+                return false;
+            }
+
+            btmp_width = info.width;
+            btmp_height = info.height;
+            raw_data_size = size;
+            pixel_data = data;
+
+            initialized = true;
+
+            return true;
+        }
+
+        //returns the array index of a pixel
+        size_t get_p_index(uint32_t x_pos, uint32_t y_pos){
+            return ((size_t)y_pos * btmp_width + x_pos) * 3;
+        }
+
+        //used by the copy constructor and copy assignment, expects this image to be empty
+        void copy_from(const PPM &other){
+            if(!other.initialized)
+                return;
+            //a copy uses the same allocator as the original, unless it already has one
+            if(!pixel_allocator)
+                pixel_allocator = other.pixel_allocator;
+            pixel_data = get_allocator().allocate(other.raw_data_size);
+            if(!pixel_data)
+                return;
+            memcpy(pixel_data, other.pixel_data, other.raw_data_size);
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            raw_data_size = other.raw_data_size;
+            initialized = true;
+        }
+
+        //used by the move constructor and move assignment, expects this image to be empty
+        void move_from(PPM &other){
+            if(!other.initialized)
+                return;
+            pixel_data = other.pixel_data;
+            pixel_allocator = other.pixel_allocator; //the pixel data has to go back to where it came from
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            raw_data_size = other.raw_data_size;
+            initialized = true;
+
+            other.pixel_data = nullptr;
+            other.btmp_width = 0;
+            other.btmp_height = 0;
+            other.raw_data_size = 0;
+            other.initialized = false;
+        }
+
+        uint32_t btmp_width = 0, btmp_height = 0;
+        size_t raw_data_size = 0;
+
+        uint8_t * pixel_data = nullptr;
+        memory::allocator *pixel_allocator = nullptr; //where pixel_data comes from, see get_allocator
+        bool initialized = false;
+    };
+}
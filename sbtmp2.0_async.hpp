@@ -0,0 +1,193 @@
+/*
+ *  Asynchronous saving and loading for Simple Bitmap 2.0
+ *
+ *  save and load block the calling thread until the whole file is written or read. When a lot of
+ *  images have to be written (rendering animations for example) this adds up. The async_io class
+ *  runs save and load on a few worker threads instead, so the calling thread can continue rendering.
+ *
+ *  The number of queued jobs is limited. If the queue is full, the functions that queue new jobs
+ *  block until a worker is free again (back-pressure), so a fast producer can't use up all the
+ *  memory with images that are waiting to be saved.
+ *  Jobs queued by the workers themselves (from a callback) don't wait, a worker waiting for a free slot
+ *  would keep its own slot busy, and once all workers wait nothing is left to empty the queue.
+ *
+ *  Completion is reported through a std::future<bool> or a callback (called on the worker thread).
+ *
+ *  IMPORTANT: images passed by reference must not be changed or destroyed until their job is done!
+ *  Pass a std::unique_ptr instead to hand the image over to the queue.
+ */
+
+
+#pragma once
+
+#include "sbtmp2.0_base.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+namespace sbtmp::io {
+
+    class async_io{
+        public:
+
+        //starts the worker threads
+        //workers: number of threads (0 = one per hardware thread), max_queued: jobs that can wait at most
+        async_io(unsigned workers = 0, size_t max_queued = 64){
+            if(workers == 0)
+                workers = std::max(1u, std::thread::hardware_concurrency());
+            queue_limit = std::max((size_t)1, max_queued);
+
+            for(unsigned i = 0; i < workers; i++){
+                threads.emplace_back([this]{ work(); });
+            }
+        }
+
+        //a worker pool can't be copied or moved, the threads point to it
+        async_io(const async_io &) = delete;
+        async_io &operator=(const async_io &) = delete;
+
+        //finishes all queued jobs and stops the workers
+        ~async_io(){
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                stopping = true;
+            }
+            job_available.notify_all();
+            for(std::thread &thread : threads){
+                thread.join();
+            }
+        }
+
+        //queues saving an image, blocks if the queue is full
+        std::future<bool> save(base::image &img, const std::string &filename){
+            return queue_future([&img, filename]{ return img.save(filename.c_str()); });
+        }
+
+        //queues saving an image and takes care of it until it is saved, blocks if the queue is full
+        std::future<bool> save(std::unique_ptr<base::image> img, const std::string &filename){
+            std::shared_ptr<base::image> owned(std::move(img));
+            return queue_future([owned, filename]{ return owned->save(filename.c_str()); });
+        }
+
+        //queues saving an image, on_done gets the result of save, blocks if the queue is full
+        //on_done may queue new jobs, they are added even if the queue is full (see top of the file)
+        void save(base::image &img, const std::string &filename, std::function<void(bool)> on_done){
+            queue_callback([&img, filename]{ return img.save(filename.c_str()); }, std::move(on_done));
+        }
+
+        //queues loading an image, blocks if the queue is full
+        std::future<bool> load(base::image &img, const std::string &filename){
+            return queue_future([&img, filename]{ return img.load(filename.c_str()); });
+        }
+
+        //queues loading an image, on_done gets the result of load, blocks if the queue is full
+        //on_done may queue new jobs, they are added even if the queue is full (see top of the file)
+        void load(base::image &img, const std::string &filename, std::function<void(bool)> on_done){
+            queue_callback([&img, filename]{ return img.load(filename.c_str()); }, std::move(on_done));
+        }
+
+        //blocks until every queued job is done
+        void wait(){
+            std::unique_lock<std::mutex> lock(mtx);
+            all_done.wait(lock, [this]{ return jobs.empty() && running == 0; });
+        }
+
+        //number of jobs that are queued or running
+        size_t pending(){
+            std::lock_guard<std::mutex> lock(mtx);
+            return jobs.size() + running;
+        }
+
+        private:
+
+        std::future<bool> queue_future(std::function<bool()> job){
+            auto result = std::make_shared<std::promise<bool>>();
+            std::future<bool> future = result->get_future();
+            push([job = std::move(job), result]{
+                try{
+                    result->set_value(job());
+                }
+                catch(...){
+                    result->set_exception(std::current_exception());
+                }
+            });
+            return future;
+        }
+
+        void queue_callback(std::function<bool()> job, std::function<void(bool)> on_done){
+            //exceptions must not leave the worker thread (std::terminate), a job that throws reports false like a failed one
+            //and an exception from on_done is dropped, there is nobody left to tell
+            push([job = std::move(job), on_done = std::move(on_done)]{
+                bool ok;
+                try{
+                    ok = job();
+                }
+                catch(...){
+                    ok = false;
+                }
+                try{
+                    if(on_done)
+                        on_done(ok);
+                }
+                catch(...){}
+            });
+        }
+
+        //adds a job, waits for a free slot if the queue is full (unless a worker of this pool adds it)
+        void push(std::function<void()> job){
+            bool from_worker = worker_of() == this;
+            std::unique_lock<std::mutex> lock(mtx);
+            slot_free.wait(lock, [&]{ return from_worker || jobs.size() < queue_limit; });
+            jobs.push_back(std::move(job));
+            lock.unlock();
+            job_available.notify_one();
+        }
+
+        //the pool the calling thread works for, nullptr for every other thread
+        static const async_io *&worker_of(){
+            static thread_local const async_io *pool = nullptr;
+            return pool;
+        }
+
+        void work(){
+            worker_of() = this;
+            while(true){
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    job_available.wait(lock, [this]{ return stopping || !jobs.empty(); });
+                    if(jobs.empty())
+                        return; // stopping and nothing left to do
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                    running++;
+                }
+                slot_free.notify_one();
+
+                job();
+
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    running--;
+                }
+                all_done.notify_all();
+            }
+        }
+
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> jobs;
+        size_t queue_limit;
+        size_t running = 0;
+        bool stopping = false;
+
+        std::mutex mtx;
+        std::condition_variable job_available, slot_free, all_done;
+    };
+}
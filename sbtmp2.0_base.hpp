@@ -1,20 +1,22 @@
 /*
- *  Simple Bitmap 2.0 by Erik S. ver exp. 0.63
+ *  Simple Bitmap 2.0 by Erik S. ver exp. 0.88
  *  (2.0 is part of the name and doesn't refer to the actual product version)
  *  
  *  A library designed to be as simple as possible while providing enough functionality to be useful
  *  enough for most basic applications.
  *  
  *  Types currently supported:
- *      -32bit Bitmap
+ *      -32bit Bitmap (BGRA and RGBA)
  *      -24bit Bitmap
+ *      -16bit Bitmap (565 and 555)
+ *      -8bit Bitmap (grayscale)
+ *      -Planar (one plane per channel, in memory only)
+ *      -Tiled (32bit BGRA in 64x64 tiles, saved as 32bit Bitmap)
+ *      -PPM (binary, P6)
+ *      -PGM (binary, P5)
+ *      -PBM (binary, P4)
  *  
  *  Planned types:
- *      -16bit Bitmap
- *      -8bit Bitmap
- *      -PPM
- *      -PGM
- *      -PBM
  *      -(Unlikely)Uncompressed PNG32 and/or 24, 16, 8
  *  
  *  This is the second (technically third) version of my Bitmap library.
@@ -57,6 +59,125 @@
  *  -0.63
  *      -fixed bug in the round_rectangle function (if radius was to small, the corners would not be drawn -> added min radius)
  *  
+ *  -0.64
+ *      -added sbtmp2.0_io.hpp (BMP header parser, memory mapped files)
+ *      -Bitmap24 and Bitmap32 can map *.bmp files directly into memory (map function)
+ *      -added missing cstring include
+ *  
+ *  -0.65
+ *      -Bitmap24 save writes the header in one block and the padded rows in large buffered blocks
+ *      -fixed wrong padding size in the Bitmap24 save and load functions
+ *      -Bitmap32 save writes the header in one block
+ *  
+ *  -0.66
+ *      -added sbtmp2.0_Bwriter.hpp (BitmapWriter, writes 24 and 32 bit bitmaps row by row for images larger than RAM)
+ *      -the buffered row writer can walk rows backwards
+ *  
+ *  -0.67
+ *      -Bitmap24 and Bitmap32 can load a rectangle of a *.bmp file without reading the rest (load_region function)
+ *  
+ *  -0.68
+ *      -added encode and decode functions to the main class (images to and from memory buffers)
+ *      -added sinks and sources to sbtmp2.0_io.hpp
+ *      -save, load and load_region of Bitmap24 and Bitmap32 are now thin wrappers around the same encoder/decoder
+ *  
+ *  -0.69
+ *      -added sbtmp2.0_async.hpp (async_io, saves and loads images on a pool of worker threads)
+ *      -the main class has a virtual destructor now
+ *  
+ *  -0.70
+ *      -Bitmap24 and Bitmap32 load palette (1, 4, 8 bit), RLE8, RLE4, BI_BITFIELDS and 16 bit bitmaps and convert them
+ *      -Bitmap24 and Bitmap32 can save RLE8/RLE4 compressed bitmaps (save_rle and encode_rle functions)
+ *  
+ *  -0.71
+ *      -added large canvas mode: 64 bit sizes in Bitmap24 and Bitmap32, pixel buffers come from sbtmp2.0_memory.hpp (huge page backed above 4 MiB)
+ *      -save and encode refuse images that are too large for the BMP header
+ *  
+ *  -0.72
+ *      -added support for top down bitmaps (negative height): loading keeps the row order of the file, set_top_down/is_top_down to choose the order for saving
+ *      -BITMAPV4/V5 headers are parsed for both row orders
+ *  
+ *  -0.73
+ *      -added PPM, PGM and PBM classes (sbtmp2.0_PPM.hpp, sbtmp2.0_PGM.hpp, sbtmp2.0_PBM.hpp), binary Netpbm files only
+ *      -added Netpbm header parser and sample scaling to sbtmp2.0_io.hpp
+ *  
+ *  -0.74
+ *      -graphics and filters functions are templates now: concrete image types are used directly, base::image through the virtual functions
+ *      -added set_pixel_unchecked/get_pixel_unchecked to all image types (used by the templates), the image classes are final
+ *      -rectangle and circle only visit pixels inside the image, filters and shapes walk the image row by row
+ *  
+ *  -0.75
+ *      -added row access to the main class (get_row, get_row_size, get_row_stride, get_bytes_per_pixel, get_channel_order, is_bottom_up, get_row_span with C++20)
+ *      -Bitmap24 and Bitmap32 return their pixel data from data() (it returned nullptr before)
+ *      -fixed decode_str cutting off the NULL char of the decoded string
+ *  
+ *  -0.76
+ *      -Bitmap24 and Bitmap32 can store their rows padded (set_row_alignment), with an alignment of 4 the memory has the file layout and is saved/loaded in one block
+ *      -pixel buffers are aligned to 64 bytes
+ *      -Bitmap24 can map files of any width
+ *  
+ *  -0.77
+ *      -added sbtmp2.0_view.hpp (ImageView, a rectangle of another image that can be used like an image without copying it)
+ *      -added convert_bw and color_invert overloads for whole images
+ *  
+ *  -0.78
+ *      -all image classes can be moved (also into containers) and copy/move assigned
+ *      -copy constructors take a const reference and copy the pixel data with a single memcpy
+ *      -fixed memory leak: Bitmap24 and Bitmap32 never freed their pixel data in the destructor
+ *  
+ *  -0.79
+ *      -added memory::allocator, images can get their pixel memory from a custom allocator (set_allocator, set_default_allocator)
+ *      -added memory::buffer_pool, reuses the pixel buffers of deleted images and counts hits and misses
+ *  
+ *  -0.80
+ *      -copies of Bitmap24 and Bitmap32 share the pixel data until one of them is changed (copy on write)
+ *      -added is_shared to Bitmap24 and Bitmap32
+ *  
+ *  -0.81
+ *      -Bitmap24 and Bitmap32 are generated from one class template (basic_bitmap in sbtmp2.0_bitmap.hpp), the pixel format is a compile time descriptor (pixel::format)
+ *      -added Bitmap32_rgba, Bitmap16 (565), Bitmap16_555 and Bitmap8 (grayscale with a gray palette)
+ *      -all of them can load every *.bmp file the others can, files are converted to the format of the image
+ *      -map only accepts BI_BITFIELDS files whose channel masks match the image (Bitmap32 accepted any masks before)
+ *      -ImageView accesses RGBA images directly
+ *  
+ *  -0.82
+ *      -added Planar (sbtmp2.0_planar.hpp), an image with one plane per channel for filters that work on one channel at a time
+ *      -Planar converts from and to the other image types with from_image/to_image, rows are split and joined with SSE kernels (sbtmp2.0_simd.hpp)
+ *      -define sbtmp_no_simd to use the plain C++ kernels
+ *  
+ *  -0.83
+ *      -added Tiled (sbtmp2.0_tiled.hpp), a 32 bit BGRA image stored in 64x64 pixel tiles for algorithms that walk columns or small blocks
+ *      -Tiled converts from and to linear rows with read_row/write_row and from_image/to_image, it saves and loads Bitmap32 files
+ *  
+ *  -0.84
+ *      -fill and rectangle (and with it round_rectangle and round_border) fill whole rows at once through base::fill_span instead of setting pixels one by one
+ *      -added image::fill_span, the bitmap types, Planar, Tiled and ImageView implement it with SIMD stores or memset (simd::fill32, fill24, fill16)
+ *      -Bitmap24 fills use a 48 byte (16 pixel) pattern, 96 bytes with AVX2
+ *  
+ *  -0.85
+ *      -convert_bw and color_invert work row by row with SIMD kernels on BGR(A) and RGB(A) images (16 pixels per iteration), large areas are split into bands of rows on several threads (base::for_each_band, base::filter_threads)
+ *      -convert_bw and blackNwhite can weight the channels by luma instead of the mean (color::gray_weighting)
+ *      -fixed set_red, set_green, set_blue and set_alpha ORing the new value into the old one, color::invert returned white because of it
+ *      -fixed blackNwhite using an uninitialized color
+ *      -fixed color_invert not accepting areas that end at the right or bottom edge of the image
+ *  
+ *  -0.86
+ *      -added sbtmp2.0_composite.hpp (composite::blit, draws an image onto another with alpha blending and clipping)
+ *      -blend modes: copy, src_over, add, multiply, screen, darken, lighten, difference, with an extra opacity
+ *      -BGRA onto BGRA/BGR rows is blended with SSE2 kernels, fully transparent and fully opaque runs are skipped/copied
+ *  
+ *  -0.87
+ *      -added rotate_90, rotate_180 and rotate_270 filters (cache blocked, squares and rotate_180 in place, other sizes are resized)
+ *      -flip_horizontal swaps whole rows with memcpy, flip_vertical reverses rows with SIMD shuffles (simd::reverse), both in parallel for large images
+ *      -added base::get_rows and base::with_pixel_size
+ *  
+ *  -0.88
+ *      -added sbtmp2.0_convert.hpp (convert_row, to_buffer, from_buffer, convert), converts between BGR, RGB, BGRA, RGBA and ARGB with SSSE3 shuffles and a configurable alpha for pixels without alpha
+ *      -added conversion constructors to all bitmap types (Bitmap32 b32(b24, alpha)...)
+ *      -added channel_order::argb
+ *      -composite::blit uses the conversion kernels for 24 bit destinations
+ *      -added get_const_row and a read only base::get_rows, the conversions, blit, Planar and Tiled read their source with it, so copies stay shared
+ *  
  */
 
 
@@ -64,9 +185,20 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <stack>
 #include <cmath>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+    #include <span>
+#endif
+
+#include "sbtmp2.0_simd.hpp"
 
 
 namespace sbtmp {
@@ -89,7 +221,7 @@ namespace sbtmp {
         constexpr Color cyan        = 0xffff00ff;
 
 
-        inline Color set_col(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha){
+        constexpr Color set_col(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha){
             return (uint32_t)blue << 24 | (uint32_t)green << 16 | (uint32_t)red << 8 | (uint32_t)alpha;
         }
 
@@ -98,40 +230,55 @@ namespace sbtmp {
         }
 
         inline void set_red(Color &col, uint8_t red){
-            col |= (uint32_t)red << 8;
+            col = (col & ~(0xffu << 8)) | (uint32_t)red << 8;
         }
 
         inline void set_green(Color &col, uint8_t green){
-            col |= (uint32_t)green << 16;
+            col = (col & ~(0xffu << 16)) | (uint32_t)green << 16;
         }
 
         inline void set_blue(Color &col, uint8_t blue){
-            col |= (uint32_t)blue << 24;
+            col = (col & ~(0xffu << 24)) | (uint32_t)blue << 24;
         }
 
         inline void set_alpha(Color &col, uint32_t alpha){
-            col |= (uint32_t)alpha;
+            col = (col & ~0xffu) | (uint8_t)alpha;
         }
 
-        inline uint8_t get_red(Color col){
+        constexpr uint8_t get_red(Color col){
             return col >> 8;
         }
 
-        inline uint8_t get_green(Color col){
+        constexpr uint8_t get_green(Color col){
             return col >> 16;
         }
 
-        inline uint8_t get_blue(Color col){
+        constexpr uint8_t get_blue(Color col){
             return col >> 24;
         }
 
-        inline uint8_t get_alpha(Color col){
+        constexpr uint8_t get_alpha(Color col){
             return col;
         }
 
-        inline Color blackNwhite(Color col){
-            uint8_t bw = (get_red(col) + get_green(col) + get_blue(col)) / 3;
-            Color out;
+        //how blackNwhite (and filters::convert_bw) weights the channels
+        enum class gray_weighting{
+            mean,   //(red + green + blue) / 3
+            luma    //0.299 red + 0.587 green + 0.114 blue (BT.601), looks closer to the brightness the eye sees
+        };
+
+        //luma weights in 1/256
+        constexpr uint16_t luma_red = 77, luma_green = 150, luma_blue = 29;
+
+        constexpr uint8_t gray_value(Color col, gray_weighting weighting = gray_weighting::mean){
+            if(weighting == gray_weighting::luma)
+                return (get_red(col) * luma_red + get_green(col) * luma_green + get_blue(col) * luma_blue + 128) >> 8;
+            return (get_red(col) + get_green(col) + get_blue(col)) / 3;
+        }
+
+        inline Color blackNwhite(Color col, gray_weighting weighting = gray_weighting::mean){
+            uint8_t bw = gray_value(col, weighting);
+            Color out = 0;
 
             set_alpha(out, get_alpha(col));
             set_red(out, bw);
@@ -370,8 +517,23 @@ namespace sbtmp {
     }
 
     namespace base{
+        //how the channels of a pixel are stored in memory
+        enum class channel_order{
+            unknown,    //the image type doesn't say
+            bgr,        //3 bytes per pixel: blue, green, red
+            bgra,       //4 bytes per pixel: blue, green, red, alpha
+            rgb,        //3 bytes per pixel: red, green, blue
+            gray,       //1 byte per pixel
+            mono,       //1 bit per pixel, the first pixel is the highest bit of a byte, 1 = black
+            rgba,       //4 bytes per pixel: red, green, blue, alpha
+            rgb565,     //16 bit little endian value per pixel: 5 bits red (highest bits), 6 bits green, 5 bits blue
+            rgb555,     //16 bit little endian value per pixel: 5 bits red, 5 bits green, 5 bits blue (highest bit unused)
+            argb        //4 bytes per pixel: alpha, red, green, blue (no image type uses it, for buffers of other libraries, see sbtmp2.0_convert.hpp)
+        };
+
         class image{
             public:
+            virtual ~image() = default; //images are often handled through a pointer to this class
             virtual bool save(const char *filename){return false;}; //saves the image to a physical file
             virtual bool load(const char *filename){return false;}; //loads image data from a physical file
             virtual void create(uint32_t length, uint32_t height){return;}; //initializes the image
@@ -385,16 +547,275 @@ namespace sbtmp {
             virtual void clear(){return;}; //clears the image (makes it blank)
             virtual void del(){return;}; //frees all image data and resets all attribute (basically uninitialize an image)
             virtual uint8_t *data(){return nullptr;}; //returns the pointer to the actual image data
+            virtual bool encode(std::vector<uint8_t> &buffer){return false;}; //encodes the image into a memory buffer (replaces its content)
+            virtual size_t encode(uint8_t *buffer, size_t size){return 0;}; //encodes the image into a caller supplied buffer, returns the number of bytes written (0 if it didn't fit)
+            virtual size_t encoded_size(){return 0;}; //returns the number of bytes encode will write
+            virtual bool decode(const uint8_t *buffer, size_t size){return false;}; //loads image data from a memory buffer
+
+            //row access, lets kernels work on whole rows (memset, memcpy, SIMD) instead of single pixels
+            //rows are numbered like the y coordinate (0 = top row), no matter in which order they are stored
+            virtual uint8_t *get_row(uint32_t y){return nullptr;}; //returns a pointer to the first pixel of row y (nullptr if there is no such row)
+            virtual const uint8_t *get_const_row(uint32_t y){return get_row(y);}; //same as get_row, but only for reading, images that share their pixels with a copy don't get their own copy for it
+            virtual size_t get_row_size(){return 0;}; //returns the number of bytes of pixel data in one row
+            virtual size_t get_row_stride(){return 0;}; //returns the distance in bytes between two rows in memory (at least get_row_size)
+            virtual uint8_t get_bytes_per_pixel(){return 0;}; //returns the size of one pixel in bytes (0 if pixels are smaller than a byte)
+            virtual channel_order get_channel_order(){return channel_order::unknown;}; //returns how the channels of a pixel are stored
+            virtual bool is_bottom_up(){return false;}; //returns true if the bottom row comes first in memory (get_row(y + 1) is below get_row(y) then)
+            virtual void fill_span(int32_t x, int32_t y, uint32_t count, color::Color col){for(uint32_t i = 0; i < count; i++) set_pixel(x + i, y, col);}; //sets count pixels of row y, starting at x, to one color (pixels outside the image are skipped)
+
+            #ifdef __cpp_lib_span
+            bool decode(std::span<const uint8_t> buffer){return decode(buffer.data(), buffer.size());}; //loads image data from a memory buffer
+            std::span<uint8_t> get_row_span(uint32_t y){uint8_t *row = get_row(y); return row ? std::span<uint8_t>(row, get_row_size()) : std::span<uint8_t>();}; //returns row y as a span (empty if there is no such row)
+            #endif
 
             //you may add more functions if you wish but these are the functions you must implement!
         };
+
+        //the graphics and filters functions are templates, so they work with base::image (through the virtual functions)
+        //and with every concrete image type directly
+        //image types that have set_pixel_unchecked/get_pixel_unchecked (no initialized or bounds checks) get
+        //these called instead of set_pixel/get_pixel, if the type is also final every pixel access inlines into a plain store/load
+
+        //true if Image has set_pixel_unchecked and get_pixel_unchecked
+        template<typename Image, typename = void>
+        struct has_unchecked_access : std::false_type {};
+
+        template<typename Image>
+        struct has_unchecked_access<Image, std::void_t<
+            decltype(std::declval<Image&>().set_pixel_unchecked(0, 0, color::Color())),
+            decltype(std::declval<Image&>().get_pixel_unchecked(0, 0))>> : std::true_type {};
+
+        //true if Image has make_writable (images that can share their pixel data with copies of them, copy on write)
+        template<typename Image, typename = void>
+        struct has_make_writable : std::false_type {};
+
+        template<typename Image>
+        struct has_make_writable<Image, std::void_t<decltype(std::declval<Image&>().make_writable())>> : std::true_type {};
+
+        //has to be called once before pixels are changed with put_pixel/put_pixel_clipped
+        //an image that shares its pixel data with copies gets its own copy here, so the unchecked setters
+        //don't have to check for it on every pixel
+        //returns false if there is not enough memory for the copy
+        template<typename Image>
+        inline bool make_writable(Image &img){
+            if constexpr(has_make_writable<Image>::value)
+                return img.make_writable();
+            else
+                return true;
+        }
+
+        //sets a pixel the caller already knows to be inside the image
+        template<typename Image>
+        inline void put_pixel(Image &img, int32_t x, int32_t y, color::Color col){
+            if constexpr(has_unchecked_access<Image>::value)
+                img.set_pixel_unchecked(x, y, col);
+            else
+                img.set_pixel(x, y, col);
+        }
+
+        //returns a pixel the caller already knows to be inside the image
+        template<typename Image>
+        inline color::Color fetch_pixel(Image &img, int32_t x, int32_t y){
+            if constexpr(has_unchecked_access<Image>::value)
+                return img.get_pixel_unchecked(x, y);
+            else
+                return img.get_pixel(x, y);
+        }
+
+        //sets a pixel that might be outside the image (it's skipped then)
+        template<typename Image>
+        inline void put_pixel_clipped(Image &img, int32_t x, int32_t y, color::Color col){
+            if constexpr(has_unchecked_access<Image>::value){
+                if((uint32_t)x < img.get_width() && (uint32_t)y < img.get_height())
+                    img.set_pixel_unchecked(x, y, col);
+            }
+            else
+                img.set_pixel(x, y, col);
+        }
+
+        //true if Image has fill_span_unchecked (sets a run of pixels in one row at once)
+        template<typename Image, typename = void>
+        struct has_span_fill : std::false_type {};
+
+        template<typename Image>
+        struct has_span_fill<Image, std::void_t<decltype(std::declval<Image&>().fill_span_unchecked(0, 0, 0, color::Color()))>> : std::true_type {};
+
+        //sets count pixels of row y, starting at x, to one color, the caller already knows them to be inside the image
+        //image types with fill_span_unchecked fill the whole run with SIMD stores (see simd::fill),
+        //everything else goes through the virtual image::fill_span (one call per run instead of one per pixel)
+        template<typename Image>
+        inline void fill_span(Image &img, int32_t x, int32_t y, uint32_t count, color::Color col){
+            if constexpr(has_span_fill<Image>::value)
+                img.fill_span_unchecked(x, y, count, col);
+            else
+                img.fill_span(x, y, count, col);
+        }
+
+        //filters split regions with at least this many pixels into bands of rows and work on them in parallel
+        constexpr uint64_t parallel_threshold = 1 << 20;
+
+        //number of threads the filters use for large regions (0 = one per hardware thread, 1 = don't use threads)
+        inline unsigned filter_threads = 0;
+
+        //calls work(first_row, end_row) for bands of rows, on several threads if the region has parallel_threshold pixels or more
+        //the calling thread works on the first band itself
+        template<typename Func>
+        inline void for_each_band(uint32_t rows, uint64_t pixels, Func work){
+            unsigned threads = filter_threads ? filter_threads : std::max(1u, std::thread::hardware_concurrency());
+            if(pixels < parallel_threshold || threads < 2 || rows < 2){
+                work(0u, rows);
+                return;
+            }
+            threads = std::min<uint32_t>(threads, rows);
+            uint32_t band = (rows + threads - 1) / threads;
+            std::vector<std::thread> workers;
+            for(uint32_t first = band; first < rows; first += band){
+                workers.emplace_back(work, first, std::min(first + band, rows));
+            }
+            work(0u, band);
+            for(std::thread &worker : workers){
+                worker.join();
+            }
+        }
+
+        //calls work(row, pixels, order) for every row of the rectangle x1, y1 (inclusive) to x2, y2 (exclusive)
+        //row points to the first pixel of the rectangle in that row, large rectangles are split into bands (see for_each_band)
+        //returns false (and does nothing) if the image has no row access or stores its pixels in a way the filters don't know,
+        //the caller has to go pixel by pixel then
+        template<typename Image, typename Func>
+        inline bool for_each_row_span(Image &img, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, Func work){
+            channel_order order = img.get_channel_order();
+            uint8_t bytes_per_pixel = img.get_bytes_per_pixel();
+            bool known = (bytes_per_pixel == 4 && (order == channel_order::bgra || order == channel_order::rgba)) ||
+                         (bytes_per_pixel == 3 && (order == channel_order::bgr || order == channel_order::rgb)) ||
+                         (bytes_per_pixel == 1 && order == channel_order::gray);
+            if(!known || x1 >= x2 || y1 >= y2)
+                return known;
+
+            //the rows are looked up first, so the workers don't call into the image
+            std::vector<uint8_t*> rows(y2 - y1);
+            for(uint32_t y = y1; y < y2; y++){
+                rows[y - y1] = img.get_row(y);
+                if(!rows[y - y1])
+                    return false;
+                rows[y - y1] += (size_t)x1 * bytes_per_pixel;
+            }
+            uint32_t width = x2 - x1;
+            for_each_band(y2 - y1, (uint64_t)width * (y2 - y1), [&](uint32_t first, uint32_t end){
+                for(uint32_t y = first; y < end; y++){
+                    work(rows[y], width, order);
+                }
+            });
+            return true;
+        }
+
+        //looks up the pointers to all rows of the image (any channel order, the pixels are only moved around)
+        //returns false if it has no row access or its pixels are smaller than a byte
+        template<typename Image>
+        inline bool get_rows(Image &img, std::vector<uint8_t*> &rows){
+            if(img.get_bytes_per_pixel() == 0)
+                return false;
+            rows.resize(img.get_height());
+            for(uint32_t y = 0; y < rows.size(); y++){
+                rows[y] = img.get_row(y);
+                if(!rows[y])
+                    return false;
+            }
+            return true;
+        }
+
+        //same as get_rows, but the rows are only read (see base::image::get_const_row), pixels shared with a copy stay shared
+        template<typename Image>
+        inline bool get_rows(Image &img, std::vector<const uint8_t*> &rows){
+            if(img.get_bytes_per_pixel() == 0)
+                return false;
+            rows.resize(img.get_height());
+            for(uint32_t y = 0; y < rows.size(); y++){
+                rows[y] = img.get_const_row(y);
+                if(!rows[y])
+                    return false;
+            }
+            return true;
+        }
+
+        //calls work(std::integral_constant<size_t, bytes_per_pixel>()), so a kernel can copy its pixels with a memcpy of a constant size
+        //returns false for pixels that aren't 1 to 4 bytes
+        template<typename Func>
+        inline bool with_pixel_size(uint8_t bytes_per_pixel, Func work){
+            switch(bytes_per_pixel){
+                case 1: work(std::integral_constant<size_t, 1>()); return true;
+                case 2: work(std::integral_constant<size_t, 2>()); return true;
+                case 3: work(std::integral_constant<size_t, 3>()); return true;
+                case 4: work(std::integral_constant<size_t, 4>()); return true;
+                default: return false;
+            }
+        }
+
+        //the rotations walk the image in blocks of rotation_block x rotation_block pixels, so the rows that are read
+        //and the rows that are written both stay in the L1 cache while a block is copied
+        constexpr uint32_t rotation_block = 32;
+
+        //copies the src_width x src_height pixels of src rotated by 90 degrees into dst (src_height x src_width pixels)
+        //clockwise: dst(x, y) = src(y, src_height - 1 - x), counterclockwise: dst(x, y) = src(src_width - 1 - y, x)
+        //bands of block rows are copied in parallel (see for_each_band)
+        template<size_t Bytes, bool Clockwise>
+        inline void rotate_copy(uint8_t *const *dst, const uint8_t *const *src, uint32_t src_width, uint32_t src_height){
+            uint32_t dst_width = src_height, dst_height = src_width;
+            uint32_t blocks = (dst_height + rotation_block - 1) / rotation_block;
+            for_each_band(blocks, (uint64_t)src_width * src_height, [&](uint32_t first, uint32_t end){
+                for(uint32_t y0 = first * rotation_block; y0 < std::min(end * rotation_block, dst_height); y0 += rotation_block){
+                    uint32_t y1 = std::min(y0 + rotation_block, dst_height);
+                    for(uint32_t x0 = 0; x0 < dst_width; x0 += rotation_block){
+                        uint32_t x1 = std::min(x0 + rotation_block, dst_width);
+                        for(uint32_t y = y0; y < y1; y++){
+                            uint8_t *out = dst[y];
+                            for(uint32_t x = x0; x < x1; x++){
+                                if constexpr(Clockwise)
+                                    memcpy(out + (size_t)x * Bytes, src[src_height - 1 - x] + (size_t)y * Bytes, Bytes);
+                                else
+                                    memcpy(out + (size_t)x * Bytes, src[x] + (size_t)(src_width - 1 - y) * Bytes, Bytes);
+                            }
+                        }
+                    }
+                }
+            });
+        }
+
+        //transposes a square image in place (pixel x, y swaps with pixel y, x), block by block like rotate_copy
+        //block row k and block row blocks - 1 - k go to the same band, so every band swaps about the same number of pixels
+        template<size_t Bytes>
+        inline void transpose_square(uint8_t *const *rows, uint32_t size){
+            uint32_t blocks = (size + rotation_block - 1) / rotation_block;
+            auto block_row = [&](uint32_t block){
+                uint32_t y0 = block * rotation_block, y1 = std::min(y0 + rotation_block, size);
+                for(uint32_t x0 = y0; x0 < size; x0 += rotation_block){
+                    uint32_t x1 = std::min(x0 + rotation_block, size);
+                    for(uint32_t y = y0; y < y1; y++){
+                        for(uint32_t x = std::max(x0, y + 1); x < x1; x++){
+                            uint8_t tmp[Bytes];
+                            memcpy(tmp, rows[y] + (size_t)x * Bytes, Bytes);
+                            memcpy(rows[y] + (size_t)x * Bytes, rows[x] + (size_t)y * Bytes, Bytes);
+                            memcpy(rows[x] + (size_t)y * Bytes, tmp, Bytes);
+                        }
+                    }
+                }
+            };
+            for_each_band((blocks + 1) / 2, (uint64_t)size * size / 2, [&](uint32_t first, uint32_t end){
+                for(uint32_t k = first; k < end; k++){
+                    block_row(k);
+                    if(blocks - 1 - k != k)
+                        block_row(blocks - 1 - k);
+                }
+            });
+        }
     }
 
     namespace graphics{
 
         //draws a line between two points
-        inline void line(base::image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, color::Color col){
-            if(!img.is_initialized())
+        template<typename Image>
+        inline void line(Image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, color::Color col){
+            if(!img.is_initialized() || !base::make_writable(img))
                 return;
             int32_t ax = x2 - x1, ay = y2 - y1;
             ax = (ax < 0) ? -ax : ax;
@@ -404,7 +825,7 @@ namespace sbtmp {
             int32_t err = dx + dy, e2;
 
             while (true) {
-                img.set_pixel(x1, y1, col);
+                base::put_pixel_clipped(img, x1, y1, col);
                 if (x1 == x2 && y1 == y2) break;
                 e2 = 2 * err;
                 if (e2 > dy){
@@ -419,23 +840,27 @@ namespace sbtmp {
         }
 
         //sets every pixel on the image to one color
-        inline void fill(base::image &img, color::Color col){
-            if(!img.is_initialized())
+        template<typename Image>
+        inline void fill(Image &img, color::Color col){
+            if(!img.is_initialized() || !base::make_writable(img))
                 return;
-            for(uint32_t y = 0; y < img.get_height(); y++){
-                for(uint32_t x = 0; x < img.get_width(); x++){
-                    img.set_pixel(x, y, col);
-                }
+            uint32_t width = img.get_width(), height = img.get_height();
+            for(uint32_t y = 0; y < height; y++){
+                base::fill_span(img, 0, y, width, col);
             }
         }
 
         //sets an area of pixels, with the same color, to another color
         //like the bucket in paint if that makes sense
-        inline void floodfill(base::image &img, int32_t x, int32_t y, color::Color col){
-            if(!img.is_initialized() || x < 0 || y < 0 || x >= img.get_width() || y >= img.get_height())
+        template<typename Image>
+        inline void floodfill(Image &img, int32_t x, int32_t y, color::Color col){
+            if(!img.is_initialized() || x < 0 || y < 0 || x >= img.get_width() || y >= img.get_height() || !base::make_writable(img))
                 return;
 
-            color::Color old_col = img.get_pixel(x, y);
+            color::Color old_col = base::fetch_pixel(img, x, y);
+            if(old_col == col) // nothing to do, would never stop otherwise
+                return;
+            uint32_t width = img.get_width(), height = img.get_height();
 
             std::stack<uint32_t> pixels_to_fill; // create a stack to store the pixel coordinates
             pixels_to_fill.push(x); // push current pixel coords into stack
@@ -450,17 +875,17 @@ namespace sbtmp {
                 x_buf = pixels_to_fill.top();
                 pixels_to_fill.pop();
 
-                if(img.get_pixel(x_buf, y_buf) == old_col){ // check if buffer has the original color
+                if(base::fetch_pixel(img, x_buf, y_buf) == old_col){ // check if buffer has the original color
 
                     //if yes then replace with new color
-                    img.set_pixel(x_buf, y_buf, col);
+                    base::put_pixel(img, x_buf, y_buf, col);
 
                     //push neighboring pixels into the stack but check if they are out of bounds
                     if(x_buf > 0){
                         pixels_to_fill.push(x_buf - 1);
                         pixels_to_fill.push(y_buf);
                     }
-                    if(x_buf < img.get_width() - 1){
+                    if(x_buf < width - 1){
                         pixels_to_fill.push(x_buf + 1);
                         pixels_to_fill.push(y_buf);
                     }
@@ -468,7 +893,7 @@ namespace sbtmp {
                         pixels_to_fill.push(x_buf);
                         pixels_to_fill.push(y_buf - 1);
                     }
-                    if(y_buf < img.get_height() - 1){
+                    if(y_buf < height - 1){
                         pixels_to_fill.push(x_buf);
                         pixels_to_fill.push(y_buf + 1);
                     }
@@ -477,68 +902,79 @@ namespace sbtmp {
         }
 
         //draws a rectangle of given size
-        inline void rectangle(base::image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, color::Color col){
-            if(!img.is_initialized() || x1 > x2 || y1 > y2)
+        template<typename Image>
+        inline void rectangle(Image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, color::Color col){
+            if(!img.is_initialized() || x1 > x2 || y1 > y2 || !base::make_writable(img))
                 return;
-            for(uint32_t i = y1; i <= y2; i++){
-                for(uint32_t j = x1; j <= x2; j++){
-                    img.set_pixel(j, i, col);
-                }
+            //cut off everything outside the image, so the pixels don't have to be checked one by one
+            int64_t first_x = std::max<int64_t>(x1, 0), last_x = std::min<int64_t>(x2, (int64_t)img.get_width() - 1);
+            int64_t first_y = std::max<int64_t>(y1, 0), last_y = std::min<int64_t>(y2, (int64_t)img.get_height() - 1);
+            if(first_x > last_x)
+                return;
+            for(int64_t i = first_y; i <= last_y; i++){
+                base::fill_span(img, first_x, i, last_x - first_x + 1, col);
             }
         }
 
         //draws a border of given size
-        inline void border(base::image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t thickness, color::Color col){
-            if(!img.is_initialized() || x1 > x2 || y1 > y2)
+        template<typename Image>
+        inline void border(Image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t thickness, color::Color col){
+            if(!img.is_initialized() || x1 > x2 || y1 > y2 || !base::make_writable(img))
                 return;
 
             //vertical lines
             for(uint32_t j = y1; j <= y2; j++){
                 //left
                 for(int32_t i = x1; i <= x1 + thickness; i++){
-                    img.set_pixel(i, j, col);
+                    base::put_pixel_clipped(img, i, j, col);
                 }
                 //right
                 for(int32_t i = x2 - thickness; i <= x2; i++){
-                    img.set_pixel(i, j, col);
+                    base::put_pixel_clipped(img, i, j, col);
                 }
             }
             //horizontal lines
             for(int32_t i = x1 + thickness; i <= x2 - thickness; i++){
                 //upper
                 for(uint32_t j = y1; j <= y1 + thickness; j++){
-                    img.set_pixel(i, j, col);
+                    base::put_pixel_clipped(img, i, j, col);
                 }
                 //lower
                 for(uint32_t j = y2 - thickness; j <= y2; j++){
-                    img.set_pixel(i, j, col);
+                    base::put_pixel_clipped(img, i, j, col);
                 }
             }
         }
 
         //draws a circle of given size
-        inline void circle(base::image &img, int32_t x_pos, int32_t y_pos, int32_t radius, color::Color col){
-            if(!img.is_initialized() || radius < 1)
+        template<typename Image>
+        inline void circle(Image &img, int32_t x_pos, int32_t y_pos, int32_t radius, color::Color col){
+            if(!img.is_initialized() || radius < 1 || !base::make_writable(img))
                 return;
-            for(int32_t i = -radius; i < radius; i++){
-                for(int32_t j = -radius; j < radius; j++){
-                    if(i * i + j * j <= radius * radius){
-                        img.set_pixel(x_pos + i, y_pos + j, col);
+            //only the part of the bounding box that is inside the image, row by row
+            int64_t first_i = std::max<int64_t>(-radius, -(int64_t)x_pos), last_i = std::min<int64_t>(radius, (int64_t)img.get_width() - x_pos);
+            int64_t first_j = std::max<int64_t>(-radius, -(int64_t)y_pos), last_j = std::min<int64_t>(radius, (int64_t)img.get_height() - y_pos);
+            for(int64_t j = first_j; j < last_j; j++){
+                for(int64_t i = first_i; i < last_i; i++){
+                    if(i * i + j * j <= (int64_t)radius * radius){
+                        base::put_pixel(img, x_pos + i, y_pos + j, col);
                     }
                 }
             }
         }
 
         //draws an ellipse of given size
-        inline void ellipse(base::image &img, int32_t x_pos, int32_t y_pos, int32_t radius, float x_mult, float y_mult, color::Color col){
-            if(!img.is_initialized() || radius < 1)
+        template<typename Image>
+        inline void ellipse(Image &img, int32_t x_pos, int32_t y_pos, int32_t radius, float x_mult, float y_mult, color::Color col){
+            if(!img.is_initialized() || radius < 1 || !base::make_writable(img))
                 return;
             float x_mult_inv = 1 / x_mult;
             float y_mult_inv = 1 / y_mult;
-            for(int32_t i = -radius * x_mult; i < radius * x_mult; i++){
-                for(int32_t j = -radius * y_mult; j < radius * y_mult; j++){
+            //row by row, so the pixels are written in the order they are stored
+            for(int32_t j = -radius * y_mult; j < radius * y_mult; j++){
+                for(int32_t i = -radius * x_mult; i < radius * x_mult; i++){
                     if(x_mult_inv * i * i + y_mult_inv * j * j <= radius * radius){
-                        img.set_pixel(x_pos + i, y_pos + j, col);
+                        base::put_pixel_clipped(img, x_pos + i, y_pos + j, col);
                     }
                 }
             }
@@ -546,12 +982,13 @@ namespace sbtmp {
 
         //draw a sector of a circle, for example a quarter or an eighth
         //both angle parameters are in degrees not radians
-        inline void circle_sector(base::image &img, int32_t x_pos, int32_t y_pos, uint32_t radius, float start_angle, float end_angle, color::Color col){
-            if(!img.is_initialized() || radius < 1)
+        template<typename Image>
+        inline void circle_sector(Image &img, int32_t x_pos, int32_t y_pos, uint32_t radius, float start_angle, float end_angle, color::Color col){
+            if(!img.is_initialized() || radius < 1 || !base::make_writable(img))
                 return;
             //calculate constant to convert degrees into radians
             const double pi_over_180 = 3.14159265 / 180.0;
-            img.set_pixel(x_pos, y_pos, col);
+            base::put_pixel_clipped(img, x_pos, y_pos, col);
             //iterate over all radii starting from 1 to and including the final radius
             for(uint32_t radius_iter = 1; radius_iter <= radius; radius_iter++){
                 //calculate the angle difference and the length of the sectors outer diameter
@@ -564,19 +1001,20 @@ namespace sbtmp {
                 //The point is calculated like this: P = (sin(a) * r | cos(a) * r)
                 for(double angle_iter = start_angle; angle_iter <= end_angle; angle_iter += angle_step){
                     //cos is negated because in the image up means smaller y while in the coordinate system up means larger y
-                    img.set_pixel(std::sin(angle_iter * pi_over_180) * radius_iter + x_pos, -std::cos(angle_iter * pi_over_180) * radius_iter + y_pos, col);
+                    base::put_pixel_clipped(img, std::sin(angle_iter * pi_over_180) * radius_iter + x_pos, -std::cos(angle_iter * pi_over_180) * radius_iter + y_pos, col);
                 }
             }
         }
 
         //draw a sector of an ellipse, for example a quarter or an eighth
         //both angle parameters are in degrees not radians
-        inline void ellipse_sector(base::image &img, int32_t x_pos, int32_t y_pos, uint32_t radius, float start_angle, float end_angle, float x_mult, float y_mult, color::Color col){
-            if(!img.is_initialized() || radius < 1)
+        template<typename Image>
+        inline void ellipse_sector(Image &img, int32_t x_pos, int32_t y_pos, uint32_t radius, float start_angle, float end_angle, float x_mult, float y_mult, color::Color col){
+            if(!img.is_initialized() || radius < 1 || !base::make_writable(img))
                 return;
             //calculate constant to convert degrees into radians
             const double pi_over_180 = 3.14159265 / 180.0;
-            img.set_pixel(x_pos, y_pos, col);
+            base::put_pixel_clipped(img, x_pos, y_pos, col);
             //iterate over all radii starting from 1 to and including the final radius
             for(uint32_t radius_iter = 1; radius_iter <= radius; radius_iter++){
                 //calculate the angle difference and the length of the sectors outer diameter
@@ -589,19 +1027,23 @@ namespace sbtmp {
                 //The point is calculated like this: P = (sin(a) * r | cos(a) * r)
                 for(double angle_iter = start_angle; angle_iter <= end_angle; angle_iter += angle_step){
                     //cos is negated because in the image up means smaller y while in the coordinate system up means larger y
-                    img.set_pixel(std::sin(angle_iter * pi_over_180) * radius_iter * x_mult + x_pos, -std::cos(angle_iter * pi_over_180) * radius_iter * y_mult + y_pos, col);
+                    base::put_pixel_clipped(img, std::sin(angle_iter * pi_over_180) * radius_iter * x_mult + x_pos, -std::cos(angle_iter * pi_over_180) * radius_iter * y_mult + y_pos, col);
                 }
             }
         }
 
         //draws a ring of given size
-        inline void ring(base::image &img, int32_t x_pos, int32_t y_pos, int32_t out_radius, int32_t in_radius, color::Color col){
-            if(!img.is_initialized() || out_radius < 1 || in_radius < 0 || out_radius < in_radius)
+        template<typename Image>
+        inline void ring(Image &img, int32_t x_pos, int32_t y_pos, int32_t out_radius, int32_t in_radius, color::Color col){
+            if(!img.is_initialized() || out_radius < 1 || in_radius < 0 || out_radius < in_radius || !base::make_writable(img))
                 return;
-            for(int32_t i = -out_radius; i < out_radius; i++){
-                for(int32_t j = -out_radius; j < out_radius; j++){
-                    if(i * i + j * j <= out_radius * out_radius && i * i + j * j >= in_radius * in_radius){
-                        img.set_pixel(x_pos + i, y_pos + j, col);
+            //only the part of the bounding box that is inside the image, row by row
+            int64_t first_i = std::max<int64_t>(-out_radius, -(int64_t)x_pos), last_i = std::min<int64_t>(out_radius, (int64_t)img.get_width() - x_pos);
+            int64_t first_j = std::max<int64_t>(-out_radius, -(int64_t)y_pos), last_j = std::min<int64_t>(out_radius, (int64_t)img.get_height() - y_pos);
+            for(int64_t j = first_j; j < last_j; j++){
+                for(int64_t i = first_i; i < last_i; i++){
+                    if(i * i + j * j <= (int64_t)out_radius * out_radius && i * i + j * j >= (int64_t)in_radius * in_radius){
+                        base::put_pixel(img, x_pos + i, y_pos + j, col);
                     }
                 }
             }
@@ -609,8 +1051,9 @@ namespace sbtmp {
 
         //draw a sector of a ring, for example a quarter or an eighth
         //both angle parameters are in degrees not radians
-        inline void ring_sector(base::image &img, int32_t x_pos, int32_t y_pos, uint32_t out_radius, uint32_t in_radius, float start_angle, float end_angle, color::Color col){
-            if(!img.is_initialized() || in_radius < 1 || out_radius <= in_radius)
+        template<typename Image>
+        inline void ring_sector(Image &img, int32_t x_pos, int32_t y_pos, uint32_t out_radius, uint32_t in_radius, float start_angle, float end_angle, color::Color col){
+            if(!img.is_initialized() || in_radius < 1 || out_radius <= in_radius || !base::make_writable(img))
                 return;
             //calculate constant to convert degrees into radians
             const double pi_over_180 = 3.14159265 / 180.0;
@@ -626,14 +1069,15 @@ namespace sbtmp {
                 //The point is calculated like this: P = (sin(a) * r | cos(a) * r)
                 for(double angle_iter = start_angle; angle_iter <= end_angle; angle_iter += angle_step){
                     //cos is negated because in the image up means smaller y while in the coordinate system up means larger y
-                    img.set_pixel(std::sin(angle_iter * pi_over_180) * radius_iter + x_pos, -std::cos(angle_iter * pi_over_180) * radius_iter + y_pos, col);
+                    base::put_pixel_clipped(img, std::sin(angle_iter * pi_over_180) * radius_iter + x_pos, -std::cos(angle_iter * pi_over_180) * radius_iter + y_pos, col);
                 }
             }
         }
 
         //draws a rounded rectangle of given size
-        inline void round_rectangle(base::image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t radius, color::Color col){
-            if(!img.is_initialized() || x1 > x2 || y1 > y2)
+        template<typename Image>
+        inline void round_rectangle(Image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t radius, color::Color col){
+            if(!img.is_initialized() || x1 > x2 || y1 > y2 || !base::make_writable(img))
                 return;
             uint32_t max_radius = std::min(std::abs(x1 - x2), std::abs(y1 - y2) / 2);
             if(radius > max_radius)
@@ -652,8 +1096,9 @@ namespace sbtmp {
         }
 
         //draws a rounded border of given size
-        inline void round_border(base::image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t thickness ,uint32_t radius, color::Color col){
-            if(!img.is_initialized() || x1 > x2 || y1 > y2)
+        template<typename Image>
+        inline void round_border(Image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t thickness ,uint32_t radius, color::Color col){
+            if(!img.is_initialized() || x1 > x2 || y1 > y2 || !base::make_writable(img))
                 return;
             uint32_t max_radius = std::min(std::abs(x1 - x2), std::abs(y1 - y2) / 2);
             uint32_t min_radius = thickness + 1;
@@ -676,8 +1121,9 @@ namespace sbtmp {
         }
 
         //draws a filled triangle
-        inline void triangle(base::image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3, color::Color col){
-            if(!img.is_initialized())
+        template<typename Image>
+        inline void triangle(Image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3, color::Color col){
+            if(!img.is_initialized() || !base::make_writable(img))
                 return;
             int32_t ax = x2 - x1, ay = y2 - y1;
             ax = (ax < 0) ? -ax : ax;
@@ -705,8 +1151,9 @@ namespace sbtmp {
         }
 
         //draw triangle border by connecting three points with lines
-        inline void triangle_border(base::image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3, color::Color col){
-            if(!img.is_initialized())
+        template<typename Image>
+        inline void triangle_border(Image &img, int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3, color::Color col){
+            if(!img.is_initialized() || !base::make_writable(img))
                 return;
             line(img, x1, y1, x2, y2, col);
             line(img, x2, y2, x3, y3, col);
@@ -715,8 +1162,9 @@ namespace sbtmp {
 
         //draws a char from namespace chars
         //character bitmap
-        inline void draw_char(base::image &img, int32_t x_pos, int32_t y_pos, uint16_t size, const chars::Charbtmp chr, color::Color col){
-            if(!img.is_initialized())
+        template<typename Image>
+        inline void draw_char(Image &img, int32_t x_pos, int32_t y_pos, uint16_t size, const chars::Charbtmp chr, color::Color col){
+            if(!img.is_initialized() || !base::make_writable(img))
                 return;
             for(int i = 0; i < 8; i++){
                 for(int j = 0; j < 5; j++){
@@ -727,8 +1175,9 @@ namespace sbtmp {
         }
 
         //draws a string
-        inline void draw_string(base::image &img, int32_t x_pos, int32_t y_pos, uint16_t size, const char *str, color::Color col){
-            if(!img.is_initialized())
+        template<typename Image>
+        inline void draw_string(Image &img, int32_t x_pos, int32_t y_pos, uint16_t size, const char *str, color::Color col){
+            if(!img.is_initialized() || !base::make_writable(img))
                 return;
             int i = 0;
             while(*str){
@@ -744,8 +1193,9 @@ namespace sbtmp {
             }
         }
 
-        inline void encode_str(base::image &img, const char *str){
-            if(!img.is_initialized())
+        template<typename Image>
+        inline void encode_str(Image &img, const char *str){
+            if(!img.is_initialized() || !base::make_writable(img))
                 return;
 
             //get string length and include NULL char
@@ -784,8 +1234,9 @@ namespace sbtmp {
             }
         }
 
-        inline const char *decode_str(base::image &img){
-            if(!img.is_initialized())
+        template<typename Image>
+        inline const char *decode_str(Image &img){
+            if(!img.is_initialized() || !base::make_writable(img))
                 return nullptr;
             
             //calculate and allocate the maximum possible string size
@@ -819,8 +1270,8 @@ namespace sbtmp {
 
                 //if the last extracted char is NULL then end the decoding process
                 if(*str_ptr == '\0'){
-                    //calculate actual stringsize
-                    str_len = str_ptr - str_buffer;
+                    //calculate actual stringsize (including the NULL char)
+                    str_len = str_ptr - str_buffer + 1;
                     esc_bit = false;
                 }
 
@@ -843,56 +1294,227 @@ namespace sbtmp {
 
     namespace filters {
 
-        //converts the image to black and white in the specified area
-        inline void convert_bw(base::image &img, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2){
-            if(!img.is_initialized() || x1 > x2 || y1 > y2 || x2 > img.get_width() || y2 > img.get_height())
+        //converts the image to black and white in the specified area (x2 and y2 are not part of it)
+        //BGR(A) and RGB(A) images are converted row by row with SIMD kernels, large areas on several threads (see base::for_each_band)
+        template<typename Image>
+        inline void convert_bw(Image &img, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, color::gray_weighting weighting = color::gray_weighting::mean){
+            if(!img.is_initialized() || x1 > x2 || y1 > y2 || x2 > img.get_width() || y2 > img.get_height() || !base::make_writable(img))
+                return;
+            bool luma = weighting == color::gray_weighting::luma;
+            bool done = base::for_each_row_span(img, x1, y1, x2, y2, [luma](uint8_t *row, uint32_t count, base::channel_order order){
+                switch(order){
+                    case base::channel_order::bgra:
+                        luma ? simd::gray_weighted4(row, count, color::luma_blue, color::luma_green, color::luma_red) : simd::gray_mean4(row, count);
+                        break;
+                    case base::channel_order::rgba:
+                        luma ? simd::gray_weighted4(row, count, color::luma_red, color::luma_green, color::luma_blue) : simd::gray_mean4(row, count);
+                        break;
+                    case base::channel_order::bgr:
+                        luma ? simd::gray_weighted3(row, count, color::luma_blue, color::luma_green, color::luma_red) : simd::gray_mean3(row, count);
+                        break;
+                    case base::channel_order::rgb:
+                        luma ? simd::gray_weighted3(row, count, color::luma_red, color::luma_green, color::luma_blue) : simd::gray_mean3(row, count);
+                        break;
+                    default: //gray images are black and white already
+                        break;
+                }
+            });
+            if(done)
                 return;
-            for(uint32_t i = x1; i < x2; i++){
-                for(uint32_t j = y1; j < y2; j++){
-                    img.set_pixel(i, j, color::blackNwhite(img.get_pixel(i, j)));
+            for(uint32_t j = y1; j < y2; j++){
+                for(uint32_t i = x1; i < x2; i++){
+                    base::put_pixel(img, i, j, color::blackNwhite(base::fetch_pixel(img, i, j), weighting));
                 }
             }
         }
 
-        //inverts the rgb values of the image in the specified area
-        inline void color_invert(base::image &img, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2){
-            if(!img.is_initialized() || x1 > x2 || y1 > y2 || x2 > img.get_width() - 1 || y2 > img.get_height() - 1)
+        //inverts the rgb values of the image in the specified area (x2 and y2 are not part of it)
+        //converted the same way as convert_bw
+        template<typename Image>
+        inline void color_invert(Image &img, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2){
+            if(!img.is_initialized() || x1 > x2 || y1 > y2 || x2 > img.get_width() || y2 > img.get_height() || !base::make_writable(img))
                 return;
-            for(uint32_t i = x1; i < x2; i++){
-                for(uint32_t j = y1; j < y2; j++){
-                    img.set_pixel(i, j, color::invert(img.get_pixel(i, j)));
+            bool done = base::for_each_row_span(img, x1, y1, x2, y2, [](uint8_t *row, uint32_t count, base::channel_order order){
+                if(order == base::channel_order::bgra || order == base::channel_order::rgba)
+                    simd::invert4(row, count);
+                else
+                    simd::invert_bytes(row, (size_t)count * (order == base::channel_order::gray ? 1 : 3));
+            });
+            if(done)
+                return;
+            for(uint32_t j = y1; j < y2; j++){
+                for(uint32_t i = x1; i < x2; i++){
+                    base::put_pixel(img, i, j, color::invert(base::fetch_pixel(img, i, j)));
                 }
             }
         }
 
-        //flips the image horizontally
-        inline void flip_horizontal(base::image &img){
-            if(!img.is_initialized())
+        //converts the whole image to black and white
+        //to convert only a part of an image, pass a formats::ImageView of it (sbtmp2.0_view.hpp)
+        template<typename Image>
+        inline void convert_bw(Image &img, color::gray_weighting weighting = color::gray_weighting::mean){
+            if(!img.is_initialized() || !base::make_writable(img))
+                return;
+            convert_bw(img, 0, 0, img.get_width(), img.get_height(), weighting);
+        }
+
+        //inverts the rgb values of the whole image
+        //to invert only a part of an image, pass a formats::ImageView of it (sbtmp2.0_view.hpp)
+        template<typename Image>
+        inline void color_invert(Image &img){
+            if(!img.is_initialized() || !base::make_writable(img))
+                return;
+            color_invert(img, 0, 0, img.get_width(), img.get_height());
+        }
+
+        //flips the image horizontally (the top row becomes the bottom row)
+        //images with row access swap whole rows with memcpy, large images in parallel (see base::for_each_band)
+        template<typename Image>
+        inline void flip_horizontal(Image &img){
+            if(!img.is_initialized() || !base::make_writable(img))
                 return;
+            uint32_t width = img.get_width(), height = img.get_height();
+            std::vector<uint8_t*> rows;
+            if(base::get_rows(img, rows)){
+                size_t size = (size_t)width * img.get_bytes_per_pixel();
+                base::for_each_band(height / 2, (uint64_t)width * height, [&](uint32_t first, uint32_t end){
+                    for(uint32_t j = first; j < end; j++){
+                        simd::swap_bytes(rows[j], rows[height - j - 1], size);
+                    }
+                });
+                return;
+            }
             color::Color buffer;
-            for(uint32_t i = 0; i < img.get_width(); i++){
-                for(uint32_t j = 0; j < img.get_height() / 2; j++){
+            for(uint32_t j = 0; j < height / 2; j++){
+                for(uint32_t i = 0; i < width; i++){
                     //swapping colors around
-                    buffer = img.get_pixel(i, img.get_height() - j - 1);
-                    img.set_pixel(i, img.get_height() - j - 1, img.get_pixel(i, j));
-                    img.set_pixel(i, j, buffer);
+                    buffer = base::fetch_pixel(img, i, height - j - 1);
+                    base::put_pixel(img, i, height - j - 1, base::fetch_pixel(img, i, j));
+                    base::put_pixel(img, i, j, buffer);
                 }
             }
         }
 
-        //flips the image vertically
-        inline void flip_vertical(base::image &img){
-            if(!img.is_initialized())
+        //flips the image vertically (the left column becomes the right column)
+        //images with row access reverse their rows with SIMD shuffles (see simd::reverse), large images in parallel
+        template<typename Image>
+        inline void flip_vertical(Image &img){
+            if(!img.is_initialized() || !base::make_writable(img))
+                return;
+            uint32_t width = img.get_width(), height = img.get_height();
+            std::vector<uint8_t*> rows;
+            if(base::get_rows(img, rows) && img.get_bytes_per_pixel() <= 4){
+                uint8_t bytes_per_pixel = img.get_bytes_per_pixel();
+                base::for_each_band(height, (uint64_t)width * height, [&](uint32_t first, uint32_t end){
+                    for(uint32_t j = first; j < end; j++){
+                        simd::reverse(rows[j], bytes_per_pixel, width);
+                    }
+                });
                 return;
+            }
             color::Color buffer;
-            for(uint32_t i = 0; i < img.get_width() / 2; i++){
-                for(uint32_t j = 0; j < img.get_height(); j++){
+            for(uint32_t j = 0; j < height; j++){
+                for(uint32_t i = 0; i < width / 2; i++){
                     //swapping colors around
-                    buffer = img.get_pixel(img.get_width() - i - 1, j);
-                    img.set_pixel(img.get_width() - i - 1, j, img.get_pixel(i, j));
-                    img.set_pixel(i, j, buffer);
+                    buffer = base::fetch_pixel(img, width - i - 1, j);
+                    base::put_pixel(img, width - i - 1, j, base::fetch_pixel(img, i, j));
+                    base::put_pixel(img, i, j, buffer);
                 }
             }
         }
+
+        //rotates the image by 180 degrees, in place
+        //images with row access reverse and swap pairs of rows in one go, large images in parallel
+        template<typename Image>
+        inline void rotate_180(Image &img){
+            if(!img.is_initialized() || !base::make_writable(img))
+                return;
+            uint32_t width = img.get_width(), height = img.get_height();
+            std::vector<uint8_t*> rows;
+            if(!base::get_rows(img, rows) || img.get_bytes_per_pixel() > 4){
+                flip_horizontal(img);
+                flip_vertical(img);
+                return;
+            }
+            uint8_t bytes_per_pixel = img.get_bytes_per_pixel();
+            base::for_each_band((height + 1) / 2, (uint64_t)width * height, [&](uint32_t first, uint32_t end){
+                for(uint32_t j = first; j < end; j++){
+                    simd::reverse(rows[j], bytes_per_pixel, width);
+                    if(j != height - j - 1){
+                        simd::reverse(rows[height - j - 1], bytes_per_pixel, width);
+                        simd::swap_bytes(rows[j], rows[height - j - 1], (size_t)width * bytes_per_pixel);
+                    }
+                }
+            });
+        }
+
+        //rotates the image by 90 degrees, clockwise or counterclockwise (used by rotate_90 and rotate_270)
+        //square images with row access are rotated in place (blocked transpose, then the rows or columns are flipped),
+        //all others are copied and resized first, so types that can't be resized (views, mapped files) can only rotate squares
+        template<typename Image>
+        inline void rotate_quarter(Image &img, bool clockwise){
+            if(!img.is_initialized() || !base::make_writable(img))
+                return;
+            uint32_t width = img.get_width(), height = img.get_height();
+            uint8_t bytes_per_pixel = img.get_bytes_per_pixel();
+            std::vector<uint8_t*> rows;
+            if(base::get_rows(img, rows) && bytes_per_pixel <= 4){
+                if(width == height){
+                    base::with_pixel_size(bytes_per_pixel, [&](auto size){
+                        base::transpose_square<decltype(size)::value>(rows.data(), width);
+                    });
+                    if(clockwise)
+                        flip_vertical(img);
+                    else
+                        flip_horizontal(img);
+                    return;
+                }
+                size_t row_size = (size_t)width * bytes_per_pixel;
+                std::vector<uint8_t> pixels(row_size * height);
+                std::vector<const uint8_t*> src(height);
+                for(uint32_t j = 0; j < height; j++){
+                    memcpy(pixels.data() + row_size * j, rows[j], row_size);
+                    src[j] = pixels.data() + row_size * j;
+                }
+                img.resize(height, width);
+                if(img.get_width() != height || img.get_height() != width || !base::get_rows(img, rows))
+                    return;
+                base::with_pixel_size(bytes_per_pixel, [&](auto size){
+                    if(clockwise)
+                        base::rotate_copy<decltype(size)::value, true>(rows.data(), src.data(), width, height);
+                    else
+                        base::rotate_copy<decltype(size)::value, false>(rows.data(), src.data(), width, height);
+                });
+                return;
+            }
+            std::vector<color::Color> pixels((size_t)width * height);
+            for(uint32_t j = 0; j < height; j++){
+                for(uint32_t i = 0; i < width; i++){
+                    pixels[(size_t)j * width + i] = base::fetch_pixel(img, i, j);
+                }
+            }
+            if(width != height){
+                img.resize(height, width);
+                if(img.get_width() != height || img.get_height() != width)
+                    return;
+            }
+            for(uint32_t j = 0; j < width; j++){
+                for(uint32_t i = 0; i < height; i++){
+                    base::put_pixel(img, i, j, clockwise ? pixels[(size_t)(height - 1 - i) * width + j] : pixels[(size_t)i * width + width - 1 - j]);
+                }
+            }
+        }
+
+        //rotates the image by 90 degrees clockwise (width and height swap, see rotate_quarter)
+        template<typename Image>
+        inline void rotate_90(Image &img){
+            rotate_quarter(img, true);
+        }
+
+        //rotates the image by 270 degrees clockwise (90 degrees counterclockwise)
+        template<typename Image>
+        inline void rotate_270(Image &img){
+            rotate_quarter(img, false);
+        }
     }
 }
\ No newline at end of file
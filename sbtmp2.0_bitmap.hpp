@@ -0,0 +1,1024 @@
+/*
+ *  Bitmap images for Simple Bitmap 2.0
+ *
+ *  All *.bmp image types are generated from one class template, basic_bitmap. The template gets a pixel format
+ *  (pixel::format) that says how many bits a pixel has and where its channels are. Everything else (saving, loading,
+ *  mapping, row access, copy on write...) is the same for all of them, so it only exists once.
+ *
+ *  Image types:
+ *      -Bitmap32       32 bit BGRA (BI_BITFIELDS, V4 header)
+ *      -Bitmap32_rgba  32 bit RGBA (BI_BITFIELDS, V4 header), for code that wants the bytes in RGBA order
+ *      -Bitmap24       24 bit BGR (BI_RGB)
+ *      -Bitmap16       16 bit 565 (BI_BITFIELDS, V4 header)
+ *      -Bitmap16_555   16 bit 555 (BI_BITFIELDS, V4 header)
+ *      -Bitmap8        8 bit grayscale (BI_RGB with a gray palette)
+ *
+ *  More can be made with basic_bitmap<pixel::format<bits, red mask, green mask, blue mask, alpha mask>>.
+ *  Pixels are converted from/to color::Color by the format at compile time, there are no runtime checks of the format.
+ *  Every type can be made from every other one, e.g. Bitmap32 b32(b24, alpha) (see the conversion constructor).
+ */
+
+
+#pragma once
+
+#include "sbtmp2.0_io.hpp"
+#include "sbtmp2.0_simd.hpp"
+#include "sbtmp2.0_convert.hpp"
+
+#include <new>
+
+namespace sbtmp::pixel {
+
+    //describes how one pixel is stored: bits per pixel (8, 16, 24 or 32) and the masks of the channels in the
+    //little endian value of a pixel, the same masks a BI_BITFIELDS *.bmp file has
+    //alpha_mask = 0: no alpha channel (get_pixel returns an alpha of 255)
+    //red, green and blue with the same mask: grayscale, colors are converted like color::blackNwhite does it
+    template<uint8_t Bits, uint32_t RedMask, uint32_t GreenMask, uint32_t BlueMask, uint32_t AlphaMask = 0>
+    struct format{
+        static_assert(Bits == 8 || Bits == 16 || Bits == 24 || Bits == 32, "pixels have to be 8, 16, 24 or 32 bits large");
+        static_assert(RedMask && GreenMask && BlueMask, "every color channel needs a mask");
+
+        static constexpr uint8_t bits_per_pixel = Bits;
+        static constexpr uint8_t bytes_per_pixel = Bits / 8;
+        static constexpr uint32_t red_mask = RedMask, green_mask = GreenMask, blue_mask = BlueMask, alpha_mask = AlphaMask;
+        static constexpr bool has_alpha = AlphaMask != 0;
+        static constexpr bool is_gray = RedMask == GreenMask && GreenMask == BlueMask;
+
+        //turns a color into the value of a pixel
+        static constexpr uint32_t pack(color::Color col){
+            if constexpr(is_gray){
+                return to_channel<RedMask>((color::get_red(col) + color::get_green(col) + color::get_blue(col)) / 3);
+            }
+            else{
+                uint32_t pixel = to_channel<RedMask>(color::get_red(col)) | to_channel<GreenMask>(color::get_green(col)) | to_channel<BlueMask>(color::get_blue(col));
+                if constexpr(has_alpha)
+                    pixel |= to_channel<AlphaMask>(color::get_alpha(col));
+                return pixel;
+            }
+        }
+
+        //turns the value of a pixel into a color
+        static constexpr color::Color unpack(uint32_t pixel){
+            uint8_t alpha = 255;
+            if constexpr(has_alpha)
+                alpha = from_channel<AlphaMask>(pixel);
+            return color::set_col(from_channel<RedMask>(pixel), from_channel<GreenMask>(pixel), from_channel<BlueMask>(pixel), alpha);
+        }
+
+        //writes the value of a pixel into memory (little endian, like in the file)
+        static void store(uint8_t *dst, uint32_t pixel){
+            memcpy(dst, &pixel, bytes_per_pixel);
+        }
+
+        //reads the value of a pixel from memory
+        static uint32_t load(const uint8_t *src){
+            uint32_t pixel = 0;
+            memcpy(&pixel, src, bytes_per_pixel);
+            return pixel;
+        }
+
+        //how the channels are ordered, as far as base::channel_order knows the format
+        static constexpr base::channel_order order(){
+            if constexpr(is_gray)
+                return Bits == 8 && RedMask == 0xff ? base::channel_order::gray : base::channel_order::unknown;
+            if(Bits == 24 && RedMask == 0xff0000 && GreenMask == 0xff00 && BlueMask == 0xff)
+                return base::channel_order::bgr;
+            if(Bits == 24 && RedMask == 0xff && GreenMask == 0xff00 && BlueMask == 0xff0000)
+                return base::channel_order::rgb;
+            if(Bits == 32 && RedMask == 0xff0000 && GreenMask == 0xff00 && BlueMask == 0xff && AlphaMask == 0xff000000)
+                return base::channel_order::bgra;
+            if(Bits == 32 && RedMask == 0xff && GreenMask == 0xff00 && BlueMask == 0xff0000 && AlphaMask == 0xff000000)
+                return base::channel_order::rgba;
+            if(Bits == 32 && RedMask == 0xff00 && GreenMask == 0xff0000 && BlueMask == 0xff000000 && AlphaMask == 0xff)
+                return base::channel_order::argb;
+            if(Bits == 16 && RedMask == 0xf800 && GreenMask == 0x07e0 && BlueMask == 0x001f && !AlphaMask)
+                return base::channel_order::rgb565;
+            if(Bits == 16 && RedMask == 0x7c00 && GreenMask == 0x03e0 && BlueMask == 0x001f && !AlphaMask)
+                return base::channel_order::rgb555;
+            return base::channel_order::unknown;
+        }
+
+
+        private:
+
+        static constexpr uint8_t shift_of(uint32_t mask){
+            uint8_t shift = 0;
+            while(!((mask >> shift) & 1)){
+                shift++;
+            }
+            return shift;
+        }
+
+        //scales an 8 bit value to the size of a channel and moves it into place
+        template<uint32_t Mask>
+        static constexpr uint32_t to_channel(uint8_t val){
+            constexpr uint8_t shift = shift_of(Mask);
+            constexpr uint32_t max = Mask >> shift;
+            if constexpr(max == 255)
+                return (uint32_t)val << shift;
+            else
+                return (((uint32_t)val * max + 127) / 255) << shift;
+        }
+
+        //extracts a channel and scales it to 8 bits (same rounding as io::bitfield)
+        template<uint32_t Mask>
+        static constexpr uint8_t from_channel(uint32_t pixel){
+            constexpr uint8_t shift = shift_of(Mask);
+            constexpr uint32_t max = Mask >> shift;
+            uint32_t val = (pixel & Mask) >> shift;
+            if constexpr(max == 255)
+                return val;
+            else
+                return (val * 255 + max / 2) / max;
+        }
+    };
+
+    using bgra32 = format<32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000>;
+    using rgba32 = format<32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000>;
+    using bgr24 = format<24, 0xff0000, 0x00ff00, 0x0000ff>;
+    using rgb565 = format<16, 0xf800, 0x07e0, 0x001f>;
+    using rgb555 = format<16, 0x7c00, 0x03e0, 0x001f>;
+    using gray8 = format<8, 0xff, 0xff, 0xff>;
+}
+
+//shut up clangd, I won't use "namespace sbtmp{ namespace formats{ }}"
+namespace sbtmp::formats{
+    template<typename Format>
+    class basic_bitmap final : public sbtmp::base::image{
+        public:
+
+        //constructor
+        basic_bitmap(uint32_t set_width, uint32_t set_height) {
+            create(set_width, set_height);
+        }
+
+        //copy constructor
+        //creates a perfect copy of the original image
+        //the copy shares the pixel data with the original, it is only copied when one of them is changed (copy on write),
+        //so copying a big image is cheap as long as the copy is only read (get_pixel, save, encode)
+        //pointers from data() or get_row() taken before the copy was made point into the shared pixels, get new ones after copying
+        //(views look up their rows on every access, they don't have to be attached again)
+        //copying a mapped image gives an ordinary image in memory, the file stays with the original
+        basic_bitmap(const basic_bitmap &other){
+            copy_from(other);
+        }
+
+        //conversion constructor
+        //creates an image of this pixel format with the picture of an image of another format (Bitmap32 from Bitmap24...)
+        //BGR(A)/RGB(A) pixels are moved with SIMD shuffles (see sbtmp2.0_convert.hpp), other formats are converted pixel by pixel
+        //alpha is used for the pixels of formats without alpha, the row order (top down or bottom up) stays the same
+        template<typename Other>
+        explicit basic_bitmap(const basic_bitmap<Other> &other, uint8_t alpha = 255){
+            convert_from(other, alpha);
+        }
+
+        //move constructor
+        //takes over the pixel data (or the mapped file) of the other image without copying anything
+        //the other image is left empty
+        basic_bitmap(basic_bitmap &&other) noexcept{
+            move_from(other);
+        }
+
+        //copy assignment, the old pixel data of this image is freed first
+        basic_bitmap &operator=(const basic_bitmap &other){
+            if(this != &other){
+                del();
+                copy_from(other);
+            }
+            return *this;
+        }
+
+        //move assignment, the old pixel data of this image is freed first
+        basic_bitmap &operator=(basic_bitmap &&other) noexcept{
+            if(this != &other){
+                del();
+                move_from(other);
+            }
+            return *this;
+        }
+
+        //allows not using the constructor
+        basic_bitmap() = default;
+
+        //destructor
+        ~basic_bitmap(){
+            // free data to prevent memory leak
+            del();
+        }
+
+        //saves the image with given filename
+        bool save(const char * filename) override {
+            if(!initialized)
+                return false;
+            std::ofstream out_image;
+            out_image.open(filename, std::ios::binary);
+            if(!out_image)
+                return false;
+
+            io::stream_sink out(out_image);
+            bool ok = encode_to(out);
+
+            out_image.close();
+
+            return ok && out_image.good();
+        }
+
+        // Load *.bmp images
+        // Might crash when trying to load a file that doesn't conform to *this* standard. Most errors are caught, but still.
+        bool load(const char * filename) override {
+            if(initialized)
+                return false;
+
+            std::ifstream in_image;
+            in_image.open(filename, std::ios::binary);
+            if(!in_image)
+                return false;
+
+            io::stream_source in(in_image);
+            return decode_from(in, 0, 0, 0, 0, true);
+        }
+
+        //loads only a rectangle of a *.bmp file, the image then has the size of the rectangle
+        //x and y are the coordinates of the upper left corner of the rectangle in the file's image
+        //only the needed rows and columns are read, so loading a small tile of a huge file is cheap
+        bool load_region(const char * filename, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
+            if(initialized)
+                return false;
+
+            std::ifstream in_image;
+            in_image.open(filename, std::ios::binary);
+            if(!in_image)
+                return false;
+
+            io::stream_source in(in_image);
+            return decode_from(in, x, y, width, height, false);
+        }
+
+        //encodes the image as *.bmp into a memory buffer (the old content of the buffer is replaced)
+        bool encode(std::vector<uint8_t> &buffer) override {
+            if(!initialized || total_size_in_bytes > UINT32_MAX) // too large for a *.bmp file
+                return false;
+            buffer.clear();
+            buffer.reserve(encoded_size());
+            io::buffer_sink out(buffer);
+            return encode_to(out);
+        }
+
+        //encodes the image as *.bmp into a caller supplied buffer
+        //returns the number of bytes written or 0 if the buffer is too small
+        size_t encode(uint8_t *buffer, size_t size) override {
+            if(!initialized || size < encoded_size())
+                return 0;
+            io::buffer_sink out(buffer, size);
+            return encode_to(out) ? out.size() : 0;
+        }
+
+        //number of bytes a *.bmp file of this image has
+        size_t encoded_size() override {
+            return initialized ? pixel_data_offset + io::bmp_row_stride(btmp_width, bits_per_pixel) * btmp_height : 0;
+        }
+
+        //loads a *.bmp file from a memory buffer
+        bool decode(const uint8_t *buffer, size_t size) override {
+            if(initialized)
+                return false;
+            io::memory_source in(buffer, size);
+            return decode_from(in, 0, 0, 0, 0, true);
+        }
+        using base::image::decode;
+
+        //saves the image as an RLE8 (bits = 8) or RLE4 (bits = 4) compressed palette bitmap
+        //flat images with large areas of one color get a lot smaller that way
+        //only works if the image has at most 256 (RLE8) or 16 (RLE4) different colors
+        //the alpha channel is not stored (palette bitmaps have none)
+        bool save_rle(const char * filename, uint16_t bits = 8){
+            if(!initialized)
+                return false;
+            std::vector<uint8_t> buffer;
+            if(!encode_rle(buffer, bits))
+                return false;
+
+            std::ofstream out_image;
+            out_image.open(filename, std::ios::binary);
+            out_image.write((char*)buffer.data(), buffer.size());
+            out_image.close();
+
+            return out_image.good();
+        }
+
+        //same as save_rle, but into a memory buffer (the old content of the buffer is replaced)
+        bool encode_rle(std::vector<uint8_t> &buffer, uint16_t bits = 8){
+            if(!initialized)
+                return false;
+            buffer.clear();
+            io::buffer_sink out(buffer);
+            if constexpr(direct_bgr){
+                //RLE files are always bottom up, so top down images are walked backwards
+                if(top_down)
+                    return io::encode_bmp_rle(out, pixel_data + (btmp_height - 1) * row_stride, btmp_width, btmp_height, bytes_per_pixel, -(ptrdiff_t)row_stride, bits);
+                return io::encode_bmp_rle(out, pixel_data, btmp_width, btmp_height, bytes_per_pixel, row_stride, bits);
+            }
+            else{
+                //the encoder wants BGR(A) pixels, so other formats are converted first (rows bottom up)
+                std::vector<uint8_t> bgra((size_t)btmp_width * btmp_height * 4);
+                for(uint32_t y = 0; y < btmp_height; y++){
+                    const uint8_t *row = pixel_data + (size_t)(top_down ? btmp_height - y - 1 : y) * row_stride;
+                    uint8_t *out_row = bgra.data() + (size_t)y * btmp_width * 4;
+                    for(uint32_t x = 0; x < btmp_width; x++){
+                        color::Color col = Format::unpack(Format::load(row + (size_t)x * bytes_per_pixel));
+                        out_row[x * 4 + 0] = color::get_blue(col);
+                        out_row[x * 4 + 1] = color::get_green(col);
+                        out_row[x * 4 + 2] = color::get_red(col);
+                        out_row[x * 4 + 3] = color::get_alpha(col);
+                    }
+                }
+                return io::encode_bmp_rle(out, bgra.data(), btmp_width, btmp_height, 4, (ptrdiff_t)btmp_width * 4, bits);
+            }
+        }
+
+        //maps a *.bmp file into memory instead of loading it, pixel_data then points directly into the file
+        //write_back = true: every change to the image ends up in the file, no need to call save
+        //write_back = false: changes stay private to this image and the file is left untouched
+        //the file has to store its pixels exactly like this image type does (see is_native)
+        //the rows keep the padding of the file, so the image gets a row alignment of 4
+        //only works on systems with mmap, returns false everywhere else
+        bool map(const char * filename, bool write_back = false){
+            if(initialized)
+                return false;
+            if(!mapping.map(filename, write_back))
+                return false;
+
+            io::bmp_info info;
+            io::memory_source in(mapping.data(), mapping.size());
+            if(!io::parse_bmp_header(mapping.data(), mapping.size(), info) || !is_native(in, info) ||
+                info.width <= 0 || info.height <= 0 || info.pixel_data_offset + (uint64_t)io::bmp_row_stride(info.width, bits_per_pixel) * info.height > mapping.size()){
+                mapping.unmap();
+                return false;
+            }
+
+            btmp_width = info.width;
+            btmp_height = info.height;
+            alignment_before_map = row_alignment;
+            row_alignment = 4; // the rows keep the padding of the file
+            row_stride = io::bmp_row_stride(btmp_width, bits_per_pixel);
+            raw_data_size = row_stride * btmp_height;
+            total_size_in_bytes = info.file_size;
+            top_down = info.top_down;
+
+            pixel_data = mapping.data() + info.pixel_data_offset;
+
+            initialized = true;
+
+            return true;
+        }
+
+        //returns true if the image data lives in a mapped file
+        bool is_mapped(){
+            return mapping.is_mapped();
+        }
+
+        //blocks until all changes of a write back mapping are on disk
+        bool sync(){
+            return mapping.sync();
+        }
+
+        //create function (recommended way to init images)
+        void create(uint32_t set_width, uint32_t set_height) override {
+            if(initialized)
+                return;
+
+            btmp_width = set_width;
+            btmp_height = set_height;
+
+            total_size_in_bytes = pixel_data_offset + (uint64_t)io::bmp_row_stride(btmp_width, bits_per_pixel) * btmp_height;
+            row_stride = stride_for(btmp_width);
+            raw_data_size = row_stride * btmp_height;
+
+            //pixel_data = (uint8_t*)realloc (pixel_data, raw_data_size);
+            pixel_data = get_allocator().allocate(raw_data_size);
+
+            initialized = true;
+        }
+
+        //set pixel at coords x, y to rgb value
+        void set_pixel(int32_t x, int32_t y, color::Color col) override {
+            if (!initialized || x > btmp_width - 1 || y > btmp_height - 1 || x < 0 || y < 0)
+                return;
+            if(shared && !make_writable())
+                return;
+            Format::store(pixel_data + get_p_index(x, y), Format::pack(col));
+        }
+
+        //get color of pixel at coords x, y
+        color::Color get_pixel(int32_t x, int32_t y) override {
+            return Format::unpack(Format::load(pixel_data + get_p_index(x, y)));
+        }
+
+        //same as set_pixel and get_pixel, but without checking if the image is initialized and the pixel is inside of it
+        //the graphics and filters templates use these for pixels they already know to be inside the image
+        //set_pixel_unchecked also doesn't check if the pixel data is shared with a copy, call make_writable once before using it
+        void set_pixel_unchecked(int32_t x, int32_t y, color::Color col){
+            Format::store(pixel_data + get_p_index(x, y), Format::pack(col));
+        }
+        color::Color get_pixel_unchecked(int32_t x, int32_t y){
+            return Format::unpack(Format::load(pixel_data + get_p_index(x, y)));
+        }
+
+        //sets count pixels of row y, starting at x, to one color (pixels outside the image are skipped)
+        void fill_span(int32_t x, int32_t y, uint32_t count, color::Color col) override {
+            int64_t first = std::max<int64_t>(x, 0), last = std::min<int64_t>((int64_t)x + count, btmp_width);
+            if(!initialized || y < 0 || y >= btmp_height || first >= last || (shared && !make_writable()))
+                return;
+            fill_span_unchecked(first, y, last - first, col);
+        }
+
+        //same as fill_span, but without any checks (see base::fill_span)
+        //the color is packed once, then the run is filled with SIMD stores
+        void fill_span_unchecked(int32_t x, int32_t y, uint32_t count, color::Color col){
+            simd::fill(pixel_data + get_p_index(x, y), Format::pack(col), bytes_per_pixel, count);
+        }
+
+        //return width of the image
+        uint32_t get_width() override {
+            return btmp_width;
+        }
+
+        //returns height of the image
+        uint32_t get_height() override {
+            return btmp_height;
+        }
+
+        //returns size of the raw data array in bytes
+        size_t get_raw_size() override {
+            return raw_data_size;
+        }
+
+        //changes the size of the image
+        void resize(uint32_t width, uint32_t height) override {
+            if(!initialized || mapping.is_mapped()) // a mapped file can't change its size
+                return;
+            if(width == btmp_width && height == btmp_height) // args are the same size as image
+                return;
+            //if(set_width < btmp_width || set_height < btmp_height) // if args are smaller
+            //    return;
+
+            if(!make_writable())
+                return;
+
+            size_t old_size = raw_data_size;
+            uint8_t *data = get_allocator().reallocate(pixel_data, old_size, stride_for(width) * height);
+            if(!data) // not enough memory, keep the old image
+                return;
+            pixel_data = data;
+
+            btmp_width = width;
+            btmp_height = height;
+
+            total_size_in_bytes = pixel_data_offset + (uint64_t)io::bmp_row_stride(btmp_width, bits_per_pixel) * btmp_height; // recalculate size attribs
+            row_stride = stride_for(btmp_width);
+            raw_data_size = row_stride * btmp_height;
+        }
+
+        //clears the image
+        void clear() override {
+            if(!initialized)
+                return;
+            if(shared){
+                //the old pixels don't have to be copied, they would be overwritten anyway
+                uint8_t *data = get_allocator().allocate(raw_data_size);
+                if(!data)
+                    return;
+                release_pixels();
+                pixel_data = data;
+                return;
+            }
+            memset(pixel_data, 0, raw_data_size);
+        }
+
+        //frees the memory of the image and resets all properties
+        void del() override {
+            if(!initialized)
+                return;
+
+            //pixel_data = (uint8_t*)realloc(pixel_data, 0); //what is this shit?
+            if(mapping.is_mapped()){
+                mapping.unmap(); // pixel_data belongs to the mapping
+                row_alignment = alignment_before_map; // the layout of the file is gone, the one the user chose is back
+            }
+            else
+                release_pixels(); // much better
+            pixel_data = nullptr;
+
+            //reset all attribs
+            btmp_width = 0;
+            btmp_height = 0;
+            total_size_in_bytes = 0;
+            raw_data_size = 0;
+            top_down = false;
+            row_stride = 0; // row_alignment stays, like the allocator, for the next create/load
+
+            // image is not initialized anymore and can be reinitialized
+            initialized = false;
+        }
+
+        //changes where the image gets its pixel memory from (a memory::buffer_pool for example)
+        //only possible while the image is empty, returns false otherwise
+        //the allocator has to live longer than the image
+        bool set_allocator(memory::allocator &alloc){
+            if(initialized)
+                return false;
+            pixel_allocator = &alloc;
+            return true;
+        }
+
+        //returns the allocator of the image (the default allocator if none was set)
+        memory::allocator &get_allocator(){
+            if(!pixel_allocator)
+                pixel_allocator = &memory::get_default_allocator();
+            return *pixel_allocator;
+        }
+
+        bool is_initialized() override {
+            return initialized;
+        }
+
+        //returns the pixel data
+        //an image that shares its pixel data with a copy gets its own copy first
+        uint8_t *data() override {
+            if(!make_writable())
+                return nullptr;
+            return pixel_data;
+        }
+
+        //returns a pointer to row y (y = 0 is the top row)
+        uint8_t *get_row(uint32_t y) override {
+            if(!initialized || y >= btmp_height || !make_writable())
+                return nullptr;
+            return pixel_data + (top_down ? y : btmp_height - y - 1) * row_stride;
+        }
+
+        //returns a pointer to row y for reading, the pixels stay shared with copies of the image
+        const uint8_t *get_const_row(uint32_t y) override {
+            if(!initialized || y >= btmp_height)
+                return nullptr;
+            return pixel_data + (top_down ? y : btmp_height - y - 1) * row_stride;
+        }
+
+        size_t get_row_size() override {
+            return (size_t)btmp_width * bytes_per_pixel;
+        }
+
+        size_t get_row_stride() override {
+            return row_stride;
+        }
+
+        uint8_t get_bytes_per_pixel() override {
+            return bytes_per_pixel;
+        }
+
+        base::channel_order get_channel_order() override {
+            return Format::order();
+        }
+
+        bool is_bottom_up() override {
+            return !top_down;
+        }
+
+        //changes the distance between two rows in memory, every row then starts at a multiple of alignment bytes
+        //1: rows are tightly packed (default)
+        //4: rows have the same layout as in a *.bmp file, saving and loading are a single block transfer
+        //64: every row starts at a cache line, SIMD kernels can use aligned loads on every row (the padding is never touched)
+        //alignment has to be a power of two, the picture stays the same, mapped images can't change their layout
+        //the alignment is kept when the image is deleted (del) and used again by the next create/load
+        bool set_row_alignment(uint32_t alignment = 64){
+            if(alignment == 0 || (alignment & (alignment - 1)) || alignment > 4096 || mapping.is_mapped())
+                return false;
+            uint32_t old_alignment = row_alignment;
+            row_alignment = alignment;
+            if(!initialized || stride_for(btmp_width) == row_stride)
+                return true;
+
+            //copy the rows into a buffer with the new layout
+            size_t new_stride = stride_for(btmp_width);
+            uint8_t *data = get_allocator().allocate(new_stride * btmp_height);
+            if(!data){
+                row_alignment = old_alignment;
+                return false;
+            }
+            for(uint32_t y = 0; y < btmp_height; y++){
+                memcpy(data + y * new_stride, pixel_data + y * row_stride, (size_t)btmp_width * bytes_per_pixel);
+            }
+            release_pixels();
+
+            pixel_data = data;
+            row_stride = new_stride;
+            raw_data_size = row_stride * btmp_height;
+            return true;
+        }
+
+        //returns the row alignment set with set_row_alignment
+        uint32_t get_row_alignment(){
+            return row_alignment;
+        }
+
+        //changes the order in which the rows are stored in memory (and in saved files), the picture stays the same
+        //top down images are stored in scanline order, so walking them from the top row on walks memory forward
+        //bottom up is the default and is understood by every program that reads *.bmp files
+        bool set_top_down(bool enable){
+            if(mapping.is_mapped()) // the file header would not match the pixel data anymore
+                return false;
+            if(enable == top_down)
+                return true;
+
+            //turn the rows around
+            if(initialized){
+                if(!make_writable())
+                    return false;
+                size_t row_size = (size_t)btmp_width * bytes_per_pixel;
+                for(uint32_t y = 0; y < btmp_height / 2; y++){
+                    uint8_t *upper = pixel_data + y * row_stride;
+                    uint8_t *lower = pixel_data + (btmp_height - y - 1) * row_stride;
+                    std::swap_ranges(upper, upper + row_size, lower);
+                }
+            }
+            top_down = enable;
+            return true;
+        }
+
+        //returns true if the rows are stored top down
+        bool is_top_down(){
+            return top_down;
+        }
+
+        //returns true if the pixel data is shared with a copy of this image (see copy constructor)
+        bool is_shared(){
+            memory::shared_buffer *buffer = shared;
+            return buffer && !buffer->is_unique();
+        }
+
+        //gives the image its own copy of the pixel data if it is shared with other images (copy on write)
+        //every function that changes pixels calls this first (the graphics and filters templates too), returns false if there is not enough memory for the copy
+        bool make_writable(){
+            memory::shared_buffer *buffer = shared;
+            if(!buffer)
+                return true;
+            if(buffer->is_unique()){
+                //all copies are gone, the buffer belongs to this image alone now
+                pixel_allocator = buffer->owner;
+                delete buffer;
+                shared = nullptr;
+                return true;
+            }
+            uint8_t *data = get_allocator().allocate(raw_data_size);
+            if(!data)
+                return false;
+            memcpy(data, pixel_data, raw_data_size);
+            release_pixels();
+            pixel_data = data;
+            return true;
+        }
+
+
+        private:
+
+        //the conversion constructor reads the pixels of the other formats directly
+        template<typename> friend class basic_bitmap;
+
+        //the io functions read and write BGR/BGRA pixels directly, every other format is converted
+        static constexpr bool direct_bgr = Format::order() == base::channel_order::bgr || Format::order() == base::channel_order::bgra;
+        //formats with channel masks other than 8 bit BGR need a BI_BITFIELDS header, which only has room for the masks in the V4 header
+        static constexpr bool has_masks = Format::bits_per_pixel == 16 || Format::bits_per_pixel == 32;
+        //8 bit bitmaps are palette images, the palette is a gray ramp
+        static constexpr uint32_t palette_size = Format::bits_per_pixel == 8 ? 256 : 0;
+        static constexpr uint8_t bytes_per_pixel = Format::bytes_per_pixel;
+
+        //true if the pixel data of a file is stored exactly like ours, it can be read or mapped without converting it then
+        static bool is_native(io::source &in, const io::bmp_info &info){
+            if(info.bits_per_pixel != bits_per_pixel)
+                return false;
+            if(info.compression == io::bi_bitfields)
+                return has_masks && info.red_mask == red_channel_bit_mask && info.green_mask == green_channel_bit_mask && info.blue_mask == blue_channel_bit_mask;
+            if(info.compression != io::bi_rgb)
+                return false;
+
+            //BI_RGB files have a fixed layout (16 bit = 555, 24 and 32 bit = BGR(X)), palette files have to have our gray ramp
+            if constexpr(bits_per_pixel == 16)
+                return red_channel_bit_mask == 0x7c00 && green_channel_bit_mask == 0x03e0 && blue_channel_bit_mask == 0x001f;
+            else if constexpr(bits_per_pixel == 8){
+                uint32_t palette[256];
+                if(io::read_bmp_palette(in, info, palette) != 256)
+                    return false;
+                for(uint32_t i = 0; i < 256; i++){
+                    if(palette[i] != (0xff000000 | i << 16 | i << 8 | i))
+                        return false;
+                }
+                return true;
+            }
+            else
+                return red_channel_bit_mask == 0xff0000 && green_channel_bit_mask == 0x00ff00 && blue_channel_bit_mask == 0x0000ff;
+        }
+
+        //reads a rectangle of any other kind of *.bmp file and converts it to our pixel format
+        static bool read_converted(io::source &in, const io::bmp_info &info, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t *dst, size_t dst_stride){
+            if constexpr(direct_bgr){
+                return io::read_bmp_region_converted(in, info, x, y, width, height, dst, dst_stride, bytes_per_pixel);
+            }
+            else{
+                //the rows are decoded to BGRA one at a time and packed into dst
+                std::vector<uint8_t> bgra((size_t)width * 4);
+                return io::read_bmp_region_rows(in, info, x, y, width, height, 4, [&](uint32_t){ return bgra.data(); },
+                                                [&](uint32_t row, const uint8_t *src){
+                    uint8_t *out = dst + row * dst_stride;
+                    for(uint32_t i = 0; i < width; i++){
+                        Format::store(out + (size_t)i * bytes_per_pixel, Format::pack(color::set_col(src[i * 4 + 2], src[i * 4 + 1], src[i * 4 + 0], src[i * 4 + 3])));
+                    }
+                });
+            }
+        }
+
+        //writes the whole *.bmp file to a sink, used by save and encode
+        bool encode_to(io::sink &out){
+            //the BMP header stores all sizes as 32 bit values, so large canvases can't be saved
+            if(total_size_in_bytes > UINT32_MAX)
+                return false;
+
+            //rows in the file are padded to a multiple of 4 bytes
+            uint32_t file_raw_size = io::bmp_row_stride(btmp_width, bits_per_pixel) * btmp_height;
+
+            //build the file header (and the palette) in memory and write it in one go
+            uint8_t header[pixel_data_offset] = {0};
+            header[0] = ID_f1;
+            header[1] = ID_f2;
+            io::put_le(header + 2, (uint32_t)total_size_in_bytes);
+            io::put_le(header + 6, unused);
+            io::put_le(header + 8, unused);
+            io::put_le(header + 10, pixel_data_offset);
+            io::put_le(header + 14, DIB_header_size);
+            io::put_le(header + 18, btmp_width);
+            io::put_le(header + 22, top_down ? -(int32_t)btmp_height : (int32_t)btmp_height); //negative height = top down
+            io::put_le(header + 26, color_planes);
+            io::put_le(header + 28, bits_per_pixel);
+            io::put_le(header + 30, Bl_RGB);
+            io::put_le(header + 34, file_raw_size);
+            io::put_le(header + 38, DPI_hor);
+            io::put_le(header + 42, DPI_ver);
+            io::put_le(header + 46, color_palette);
+            io::put_le(header + 50, imp_colors);
+            if constexpr(has_masks){
+                //missing header data(added since ver exp 0.34)
+                io::put_le(header + 54, red_channel_bit_mask);
+                io::put_le(header + 58, green_channel_bit_mask);
+                io::put_le(header + 62, blue_channel_bit_mask);
+                io::put_le(header + 66, alpha_channel_bit_mask);
+                memcpy(header + 70, color_space, 4);
+                //color space endpoints and gamma stay 0
+            }
+            for(uint32_t i = 0; i < palette_size; i++){
+                io::put_le(header + 14 + DIB_header_size + i * 4, i << 16 | i << 8 | i);
+            }
+
+            //the rows are stored in the same order in memory as in the file, so they can be written in order
+            //the writer takes care of the padding, rows that already have the file's stride are written in one go
+            return out.write(header, sizeof(header)) && io::write_padded_rows(out, pixel_data, (size_t)btmp_width * bytes_per_pixel, row_stride, btmp_height);
+        }
+
+        //reads a *.bmp file (or a rectangle of it if whole_image is false) from a source, used by all load functions
+        bool decode_from(io::source &in, uint32_t x, uint32_t y, uint32_t width, uint32_t height, bool whole_image){
+            if(initialized)
+                return false;
+
+            io::bmp_info info;
+            if(!io::read_bmp_header(in, info) || info.width <= 0 || info.height <= 0)
+                return false;
+
+            if(whole_image){
+                x = 0;
+                y = 0;
+                width = info.width;
+                height = info.height;
+            }
+            if(width == 0 || height == 0 || (uint64_t)x + width > (uint32_t)info.width || (uint64_t)y + height > (uint32_t)info.height)
+                return false;
+
+            //a header can claim any size, don't allocate memory for pixels the file can't have
+            if(!io::bmp_data_fits(in, info))
+                return false;
+
+            //files with the same layout as ours are read directly, everything else is converted
+            bool native = is_native(in, info);
+
+            //allocate memory and load the image data
+            size_t stride = stride_for(width);
+            uint8_t *data = get_allocator().allocate(stride * height);
+            if(!data)
+                return false;
+            //the decoders need some memory of their own, load returns false instead of throwing if there isn't enough
+            bool ok;
+            try{
+                ok = native ? io::read_bmp_region(in, info, x, y, width, height, data, stride) : read_converted(in, info, x, y, width, height, data, stride);
+            }
+            catch(const std::bad_alloc &){
+                ok = false;
+            }
+            if(!ok){
+                get_allocator().deallocate(data, stride * height);
+                return false;
+            }
+
+            btmp_width = width;
+            btmp_height = height;
+            row_stride = stride;
+            raw_data_size = row_stride * btmp_height;
+            top_down = info.top_down; // keep the row order of the file
+            total_size_in_bytes = pixel_data_offset + (uint64_t)io::bmp_row_stride(btmp_width, bits_per_pixel) * btmp_height;
+            pixel_data = data;
+
+            initialized = true;
+
+            return true;
+        }
+
+        //just two little helper function
+        //used to get the array index of any pixel/byte
+        size_t get_p_index(uint32_t x_pos, uint32_t y_pos){
+            //pixel index
+            //bottom up images are stored upside down, so y_pos has to be inverted
+            size_t row = top_down ? y_pos : btmp_height - y_pos - 1;
+            return row * row_stride + (size_t)x_pos * bytes_per_pixel;
+        }
+        size_t get_r_index(uint32_t x_pos, uint32_t y_pos){
+            //raw index
+            return ((size_t)y_pos * row_stride + x_pos);
+        }
+
+        //used by the copy constructor and copy assignment, expects this image to be empty
+        void copy_from(const basic_bitmap &other){
+            if(!other.initialized)
+                return;
+            //a copy uses the same allocator as the original, unless it already has one
+            if(!pixel_allocator)
+                pixel_allocator = other.pixel_allocator;
+            if(other.mapping.is_mapped()){
+                pixel_data = get_allocator().allocate(other.raw_data_size);
+                if(!pixel_data)
+                    return;
+                memcpy(pixel_data, other.pixel_data, other.raw_data_size);
+            }
+            else{
+                //share the pixel data, see make_writable
+                shared = other.share();
+                pixel_data = other.pixel_data;
+            }
+
+            total_size_in_bytes = other.total_size_in_bytes;
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            raw_data_size = other.raw_data_size;
+            top_down = other.top_down;
+            row_alignment = other.row_alignment;
+            row_stride = other.row_stride;
+            initialized = true;
+        }
+
+        //returns the shared_buffer of the pixel data with one more reference, the first copy creates it
+        //a const image can be copied on several threads at once, so the buffer is published with a compare exchange,
+        //a thread that loses the race uses the buffer of the winner
+        memory::shared_buffer *share() const {
+            memory::shared_buffer *buffer = shared.load(std::memory_order_acquire);
+            if(!buffer){
+                memory::shared_buffer *created = new memory::shared_buffer(pixel_allocator);
+                if(shared.compare_exchange_strong(buffer, created, std::memory_order_acq_rel, std::memory_order_acquire))
+                    buffer = created;
+                else
+                    delete created;
+            }
+            buffer->add_ref();
+            return buffer;
+        }
+
+        //used by the conversion constructor, expects this image to be empty
+        template<typename Other>
+        void convert_from(const basic_bitmap<Other> &other, uint8_t alpha){
+            if(!other.initialized)
+                return;
+            pixel_allocator = other.pixel_allocator;
+            top_down = other.top_down;
+            create(other.btmp_width, other.btmp_height);
+            if(!pixel_data){ // not enough memory
+                initialized = false;
+                return;
+            }
+
+            constexpr base::channel_order from = Other::order(), to = Format::order();
+            base::for_each_band(btmp_height, (uint64_t)btmp_width * btmp_height, [&](uint32_t first, uint32_t end){
+                for(uint32_t y = first; y < end; y++){
+                    const uint8_t *src = other.pixel_data + (size_t)(other.top_down ? y : btmp_height - y - 1) * other.row_stride;
+                    uint8_t *dst = pixel_data + get_p_index(0, y);
+                    if constexpr(convert::is_supported(from) && convert::is_supported(to)){
+                        convert::convert_row(src, from, dst, to, btmp_width, alpha);
+                    }
+                    else{
+                        for(uint32_t x = 0; x < btmp_width; x++){
+                            color::Color col = Other::unpack(Other::load(src + (size_t)x * Other::bytes_per_pixel));
+                            if constexpr(!Other::has_alpha)
+                                color::set_alpha(col, alpha);
+                            Format::store(dst + (size_t)x * bytes_per_pixel, Format::pack(col));
+                        }
+                    }
+                }
+            });
+        }
+
+        //used by the move constructor and move assignment, expects this image to be empty
+        void move_from(basic_bitmap &other){
+            if(!other.initialized)
+                return;
+            pixel_data = other.pixel_data;
+            pixel_allocator = other.pixel_allocator; //the pixel data has to go back to where it came from
+            shared = other.shared.load();
+            mapping = std::move(other.mapping);
+
+            total_size_in_bytes = other.total_size_in_bytes;
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            raw_data_size = other.raw_data_size;
+            top_down = other.top_down;
+            row_alignment = other.row_alignment;
+            alignment_before_map = other.alignment_before_map;
+            row_stride = other.row_stride;
+            initialized = true;
+
+            //the pixel data belongs to this image now, so other must not free it
+            other.pixel_data = nullptr;
+            other.shared = nullptr;
+            other.btmp_width = 0;
+            other.btmp_height = 0;
+            other.total_size_in_bytes = 0;
+            other.raw_data_size = 0;
+            other.top_down = false;
+            other.row_alignment = 1;
+            other.row_stride = 0;
+            other.initialized = false;
+        }
+
+        //frees the pixel data, shared pixel data is only freed by the last image using it
+        void release_pixels(){
+            memory::shared_buffer *buffer = shared;
+            if(buffer){
+                if(buffer->release()){
+                    buffer->owner->deallocate(pixel_data, raw_data_size);
+                    delete buffer;
+                }
+                shared = nullptr;
+            }
+            else
+                get_allocator().deallocate(pixel_data, raw_data_size);
+            pixel_data = nullptr;
+        }
+
+        //distance between two rows of an image with this width in memory
+        size_t stride_for(uint32_t width){
+            return ((size_t)width * bytes_per_pixel + row_alignment - 1) & ~((size_t)row_alignment - 1);
+        }
+
+        //BMP header
+        static constexpr char ID_f1 = 'B', ID_f2 = 'M';
+        uint64_t total_size_in_bytes = 0;
+        static constexpr uint16_t unused = 0;
+        static constexpr uint32_t DIB_header_size = has_masks ? 108 : 40;
+        static constexpr uint32_t pixel_data_offset = 14 + DIB_header_size + palette_size * 4;
+
+        //DIB header
+        uint32_t btmp_width = 0, btmp_height = 0;
+        static constexpr uint16_t color_planes = 1;
+        static constexpr uint16_t bits_per_pixel = Format::bits_per_pixel;
+        static constexpr uint32_t Bl_RGB = has_masks ? io::bi_bitfields : io::bi_rgb;
+        size_t raw_data_size = 0;
+        static constexpr uint32_t DPI_hor = 2835, DPI_ver = 2835;
+        static constexpr uint32_t color_palette = palette_size;
+        static constexpr uint32_t imp_colors = 0;
+        //additional information needed for bitmaps with channel masks
+        static constexpr uint32_t red_channel_bit_mask = Format::red_mask;
+        static constexpr uint32_t green_channel_bit_mask = Format::green_mask;
+        static constexpr uint32_t blue_channel_bit_mask = Format::blue_mask;
+        static constexpr uint32_t alpha_channel_bit_mask = Format::alpha_mask;
+        static constexpr char color_space[4] = {' ', 'n', 'i', 'W'};
+
+        uint8_t * pixel_data = nullptr;
+        memory::allocator *pixel_allocator = nullptr; //where pixel_data comes from, see get_allocator
+        mutable std::atomic<memory::shared_buffer*> shared{nullptr}; //only set while the pixel data is shared with copies of the image (see share)
+        bool initialized = false;
+        bool top_down = false; //rows are stored top down instead of bottom up
+        uint32_t row_alignment = 1; //rows start at multiples of this many bytes
+        uint32_t alignment_before_map = 1; //row_alignment while a file is mapped is the one of the file, this is the one to go back to
+        size_t row_stride = 0; //distance between two rows in memory
+        io::mapped_file mapping; //only used by mapped images
+    };
+
+    using Bitmap32 = basic_bitmap<pixel::bgra32>;
+    using Bitmap32_rgba = basic_bitmap<pixel::rgba32>;
+    using Bitmap24 = basic_bitmap<pixel::bgr24>;
+    using Bitmap16 = basic_bitmap<pixel::rgb565>;
+    using Bitmap16_555 = basic_bitmap<pixel::rgb555>;
+    using Bitmap8 = basic_bitmap<pixel::gray8>;
+}
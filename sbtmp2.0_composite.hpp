@@ -0,0 +1,227 @@
+/*
+ *  Compositing for Simple Bitmap 2.0
+ *
+ *  Draws one image onto another with alpha blending, for sprites, labels, overlays...
+ *
+ *  composite::blit(dst, src, x, y, mode, opacity) blends src onto dst with its upper left corner at x, y.
+ *  Parts of src outside of dst are cut off, x and y may be negative.
+ *
+ *  All modes blend by the alpha of the source (times opacity): the result is mode(dst, src) where the source is opaque,
+ *  dst where it is transparent and a mix of both in between. The colors of dst are used as they are (not premultiplied),
+ *  the alpha of dst becomes src alpha + dst alpha * (1 - src alpha), images without alpha stay opaque.
+ *
+ *  BGRA sources (Bitmap32, views of one) drawn onto BGRA or BGR images (Bitmap32, Bitmap24, views of them) are blended
+ *  4 pixels at a time with 16 bit fixed point SSE2 kernels. Runs of fully transparent source pixels are skipped and fully
+ *  opaque ones are copied without blending (src_over). Every other combination of image types works too, pixel by pixel.
+ *  Both give exactly the same result.
+ */
+
+
+#pragma once
+
+#include "sbtmp2.0_base.hpp"
+
+namespace sbtmp::composite {
+
+    enum class blend_mode{
+        copy,       //the source replaces the destination, alpha included (no blending)
+        src_over,   //the source is drawn over the destination (normal alpha blending)
+        add,        //source + destination (clamped to 255)
+        multiply,   //source * destination, makes things darker
+        screen,     //1 - (1 - source) * (1 - destination), makes things lighter
+        darken,     //the darker of both per channel
+        lighten,    //the lighter of both per channel
+        difference  //|source - destination|
+    };
+
+    //x / 255, rounded, for every x up to 255 * 255
+    constexpr uint8_t div255(uint32_t x){
+        return (x + 128 + ((x + 128) >> 8)) >> 8;
+    }
+
+    //the color of a channel if the source was opaque
+    constexpr uint8_t blend_channel(uint8_t dst, uint8_t src, blend_mode mode){
+        switch(mode){
+            case blend_mode::add:
+                return std::min(255, dst + src);
+            case blend_mode::multiply:
+                return div255(dst * src);
+            case blend_mode::screen:
+                return dst + src - div255(dst * src);
+            case blend_mode::darken:
+                return std::min(dst, src);
+            case blend_mode::lighten:
+                return std::max(dst, src);
+            case blend_mode::difference:
+                return dst > src ? dst - src : src - dst;
+            default:
+                return src;
+        }
+    }
+
+    //blends one pixel, opacity is multiplied with the alpha of src
+    constexpr color::Color blend(color::Color dst, color::Color src, blend_mode mode, uint8_t opacity = 255){
+        uint8_t alpha = div255(color::get_alpha(src) * opacity);
+        if(mode == blend_mode::copy)
+            return color::set_col(color::get_red(src), color::get_green(src), color::get_blue(src), alpha);
+        uint8_t inverse = 255 - alpha;
+        uint8_t red = div255(blend_channel(color::get_red(dst), color::get_red(src), mode) * alpha + color::get_red(dst) * inverse);
+        uint8_t green = div255(blend_channel(color::get_green(dst), color::get_green(src), mode) * alpha + color::get_green(dst) * inverse);
+        uint8_t blue = div255(blend_channel(color::get_blue(dst), color::get_blue(src), mode) * alpha + color::get_blue(dst) * inverse);
+        return color::set_col(red, green, blue, alpha + div255(color::get_alpha(dst) * inverse));
+    }
+
+#ifdef sbtmp_has_sse2
+    //div255 for 8 16 bit lanes
+    inline __m128i div255(__m128i x){
+        x = _mm_add_epi16(x, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+
+    //blends 2 BGRA pixels in 16 bit lanes, b is the color of the mode (blend_channel) and s the source for the alpha
+    inline __m128i blend16(__m128i d, __m128i s, __m128i b, __m128i opacity, bool use_opacity){
+        const __m128i alpha_lanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+        if(use_opacity)
+            alpha = div255(_mm_mullo_epi16(alpha, opacity));
+        __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+        __m128i kept = _mm_mullo_epi16(d, inverse);
+
+        //colors: b * alpha + d * (1 - alpha), alpha: alpha + d alpha * (1 - alpha)
+        __m128i col = div255(_mm_add_epi16(_mm_mullo_epi16(b, alpha), kept));
+        __m128i out_alpha = _mm_add_epi16(alpha, div255(kept));
+        return _mm_or_si128(_mm_andnot_si128(alpha_lanes, col), _mm_and_si128(alpha_lanes, out_alpha));
+    }
+#endif
+
+    //blends count BGRA pixels of src onto the BGRA pixels of dst
+    template<blend_mode Mode>
+    inline void blend_row(uint8_t *dst, const uint8_t *src, size_t count, uint8_t opacity){
+        size_t i = 0;
+        if constexpr(Mode == blend_mode::copy){
+            if(opacity == 255){
+                memcpy(dst, src, count * 4);
+                return;
+            }
+        }
+    #ifdef sbtmp_has_sse2
+        const __m128i zero = _mm_setzero_si128(), alpha_bytes = _mm_set1_epi32((int32_t)0xff000000);
+        const __m128i opacity16 = _mm_set1_epi16(opacity);
+        bool use_opacity = opacity != 255;
+        for(; Mode != blend_mode::copy && i + 4 <= count; i += 4){
+            __m128i s = _mm_loadu_si128((const __m128i*)(src + i * 4));
+            __m128i s_alpha = _mm_and_si128(s, alpha_bytes);
+            //4 transparent pixels don't change anything
+            if(_mm_movemask_epi8(_mm_cmpeq_epi32(s_alpha, zero)) == 0xffff)
+                continue;
+            //4 opaque pixels drawn over the destination replace it
+            if(Mode == blend_mode::src_over && !use_opacity && _mm_movemask_epi8(_mm_cmpeq_epi32(s_alpha, alpha_bytes)) == 0xffff){
+                _mm_storeu_si128((__m128i*)(dst + i * 4), s);
+                continue;
+            }
+
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+            //modes that work on bytes are done before the pixels are spread to 16 bit
+            __m128i b = s;
+            if constexpr(Mode == blend_mode::add)
+                b = _mm_adds_epu8(d, s);
+            else if constexpr(Mode == blend_mode::darken)
+                b = _mm_min_epu8(d, s);
+            else if constexpr(Mode == blend_mode::lighten)
+                b = _mm_max_epu8(d, s);
+            else if constexpr(Mode == blend_mode::difference)
+                b = _mm_or_si128(_mm_subs_epu8(d, s), _mm_subs_epu8(s, d));
+
+            __m128i d_lo = _mm_unpacklo_epi8(d, zero), d_hi = _mm_unpackhi_epi8(d, zero);
+            __m128i s_lo = _mm_unpacklo_epi8(s, zero), s_hi = _mm_unpackhi_epi8(s, zero);
+            __m128i b_lo = _mm_unpacklo_epi8(b, zero), b_hi = _mm_unpackhi_epi8(b, zero);
+            if constexpr(Mode == blend_mode::multiply){
+                b_lo = div255(_mm_mullo_epi16(d_lo, s_lo));
+                b_hi = div255(_mm_mullo_epi16(d_hi, s_hi));
+            }
+            else if constexpr(Mode == blend_mode::screen){
+                b_lo = _mm_sub_epi16(_mm_add_epi16(d_lo, s_lo), div255(_mm_mullo_epi16(d_lo, s_lo)));
+                b_hi = _mm_sub_epi16(_mm_add_epi16(d_hi, s_hi), div255(_mm_mullo_epi16(d_hi, s_hi)));
+            }
+            __m128i lo = blend16(d_lo, s_lo, b_lo, opacity16, use_opacity);
+            __m128i hi = blend16(d_hi, s_hi, b_hi, opacity16, use_opacity);
+            _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(lo, hi));
+        }
+    #endif
+        for(; i < count; i++){
+            color::Color d = color::set_col(dst[i * 4 + 2], dst[i * 4 + 1], dst[i * 4 + 0], dst[i * 4 + 3]);
+            color::Color s = color::set_col(src[i * 4 + 2], src[i * 4 + 1], src[i * 4 + 0], src[i * 4 + 3]);
+            color::Color out = blend(d, s, Mode, opacity);
+            dst[i * 4 + 0] = color::get_blue(out);
+            dst[i * 4 + 1] = color::get_green(out);
+            dst[i * 4 + 2] = color::get_red(out);
+            dst[i * 4 + 3] = color::get_alpha(out);
+        }
+    }
+
+    //blends count BGRA pixels of src onto the BGR pixels of dst
+    //the destination is spread to opaque BGRA pixels in small blocks, blended with blend_row and packed again
+    template<blend_mode Mode>
+    inline void blend_row_bgr(uint8_t *dst, const uint8_t *src, size_t count, uint8_t opacity){
+        constexpr size_t block = 64;
+        constexpr uint8_t to_bgra[4] = {0, 1, 2, 0xff}, to_bgr[4] = {0, 1, 2, 0xff};
+        uint8_t buffer[block * 4];
+        for(size_t first = 0; first < count; first += block){
+            size_t n = std::min(block, count - first);
+            uint8_t *d = dst + first * 3;
+            simd::shuffle_pixels(d, 3, buffer, 4, to_bgra, 255, n);
+            blend_row<Mode>(buffer, src + first * 4, n, opacity);
+            simd::shuffle_pixels(buffer, 4, d, 3, to_bgr, 255, n);
+        }
+    }
+
+    //picks the kernel for a mode (the modes are template arguments, so every kernel only contains the code of its mode)
+    inline void blend_row(uint8_t *dst, const uint8_t *src, size_t count, uint8_t dst_bytes_per_pixel, blend_mode mode, uint8_t opacity){
+        #define sbtmp_blend_case(m) case blend_mode::m: dst_bytes_per_pixel == 4 ? blend_row<blend_mode::m>(dst, src, count, opacity) : blend_row_bgr<blend_mode::m>(dst, src, count, opacity); break;
+        switch(mode){
+            sbtmp_blend_case(copy)
+            sbtmp_blend_case(src_over)
+            sbtmp_blend_case(add)
+            sbtmp_blend_case(multiply)
+            sbtmp_blend_case(screen)
+            sbtmp_blend_case(darken)
+            sbtmp_blend_case(lighten)
+            sbtmp_blend_case(difference)
+        }
+        #undef sbtmp_blend_case
+    }
+
+    //blends src onto dst with the upper left corner of src at x, y (see top of the file)
+    //opacity is multiplied with the alpha of every source pixel, 255 = use the alpha as it is
+    template<typename Dst, typename Src>
+    inline void blit(Dst &dst, Src &src, int32_t x, int32_t y, blend_mode mode = blend_mode::src_over, uint8_t opacity = 255){
+        if(!dst.is_initialized() || !src.is_initialized() || (opacity == 0 && mode != blend_mode::copy))
+            return;
+
+        //the part of src that is inside dst
+        int64_t first_x = std::max<int64_t>(0, -(int64_t)x), last_x = std::min<int64_t>(src.get_width(), (int64_t)dst.get_width() - x);
+        int64_t first_y = std::max<int64_t>(0, -(int64_t)y), last_y = std::min<int64_t>(src.get_height(), (int64_t)dst.get_height() - y);
+        if(first_x >= last_x || first_y >= last_y || !base::make_writable(dst))
+            return;
+        uint32_t width = last_x - first_x;
+
+        //BGRA onto BGRA or BGR, row by row
+        base::channel_order dst_order = dst.get_channel_order();
+        uint8_t dst_bytes = dst.get_bytes_per_pixel();
+        bool rows = src.get_channel_order() == base::channel_order::bgra && src.get_bytes_per_pixel() == 4 &&
+                    ((dst_order == base::channel_order::bgra && dst_bytes == 4) || (dst_order == base::channel_order::bgr && dst_bytes == 3));
+        if(rows && src.get_const_row(first_y) && dst.get_row(first_y + y)){
+            for(int64_t j = first_y; j < last_y; j++){
+                blend_row(dst.get_row(j + y) + (x + first_x) * dst_bytes, src.get_const_row(j) + first_x * 4, width, dst_bytes, mode, opacity);
+            }
+            return;
+        }
+
+        for(int64_t j = first_y; j < last_y; j++){
+            for(int64_t i = first_x; i < last_x; i++){
+                color::Color s = base::fetch_pixel(src, i, j);
+                base::put_pixel(dst, x + i, y + j, blend(base::fetch_pixel(dst, x + i, y + j), s, mode, opacity));
+            }
+        }
+    }
+}
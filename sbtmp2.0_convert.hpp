@@ -0,0 +1,194 @@
+/*
+ *  Channel order conversion for Simple Bitmap 2.0
+ *
+ *  Converts pixels between BGR, RGB, BGRA, RGBA and ARGB, for going from Bitmap24 to Bitmap32 and back or for
+ *  handing pixels to other libraries (most want RGBA). The bytes are moved with SSSE3 shuffles (see simd::shuffle_pixels),
+ *  large images are converted on several threads (see base::for_each_band).
+ *
+ *  convert::convert_row    count pixels from one buffer to another
+ *  convert::to_buffer      a whole image into a buffer
+ *  convert::from_buffer    a buffer into a whole image
+ *  convert::convert        an image into another image of the same size (views too)
+ *
+ *  Pixels without alpha get the alpha that is passed (255 by default) when they are converted to an order with alpha.
+ *  Images that don't store their pixels in one of these orders (16 bit, gray, Planar...) work too, pixel by pixel.
+ *  The basic_bitmap conversion constructors (Bitmap32 from Bitmap24...) use the same functions.
+ */
+
+
+#pragma once
+
+#include "sbtmp2.0_base.hpp"
+
+namespace sbtmp::convert {
+
+    //true for the channel orders the conversions move bytes for directly
+    constexpr bool is_supported(base::channel_order order){
+        return order == base::channel_order::bgr || order == base::channel_order::rgb || order == base::channel_order::bgra ||
+               order == base::channel_order::rgba || order == base::channel_order::argb;
+    }
+
+    //true for the orders that have an alpha byte
+    constexpr bool has_alpha(base::channel_order order){
+        return order == base::channel_order::bgra || order == base::channel_order::rgba || order == base::channel_order::argb;
+    }
+
+    //true for the orders that are known to have no alpha (their pixels get the alpha passed to the conversions)
+    constexpr bool lacks_alpha(base::channel_order order){
+        return order == base::channel_order::bgr || order == base::channel_order::rgb || order == base::channel_order::gray ||
+               order == base::channel_order::mono || order == base::channel_order::rgb565 || order == base::channel_order::rgb555;
+    }
+
+    //size of a pixel of a supported order
+    constexpr uint8_t bytes_per_pixel(base::channel_order order){
+        return has_alpha(order) ? 4 : 3;
+    }
+
+    //byte of red, green, blue and alpha in a pixel of a supported order (0xff = there is no such byte)
+    struct layout{
+        uint8_t red, green, blue, alpha;
+    };
+
+    constexpr layout layout_of(base::channel_order order){
+        switch(order){
+            case base::channel_order::bgr: return {2, 1, 0, 0xff};
+            case base::channel_order::rgb: return {0, 1, 2, 0xff};
+            case base::channel_order::bgra: return {2, 1, 0, 3};
+            case base::channel_order::rgba: return {0, 1, 2, 3};
+            case base::channel_order::argb: return {1, 2, 3, 0};
+            default: return {0xff, 0xff, 0xff, 0xff};
+        }
+    }
+
+    //the byte map for simd::shuffle_pixels: byte n of a dst pixel is byte map[n] of the src pixel
+    inline void make_map(base::channel_order src_order, base::channel_order dst_order, uint8_t map[4]){
+        layout src = layout_of(src_order), dst = layout_of(dst_order);
+        map[0] = map[1] = map[2] = map[3] = 0xff;
+        map[dst.red] = src.red;
+        map[dst.green] = src.green;
+        map[dst.blue] = src.blue;
+        if(dst.alpha != 0xff)
+            map[dst.alpha] = src.alpha;
+    }
+
+    //writes a color as one pixel of a supported order
+    inline void store_color(uint8_t *pixel, base::channel_order order, color::Color col){
+        layout l = layout_of(order);
+        pixel[l.red] = color::get_red(col);
+        pixel[l.green] = color::get_green(col);
+        pixel[l.blue] = color::get_blue(col);
+        if(l.alpha != 0xff)
+            pixel[l.alpha] = color::get_alpha(col);
+    }
+
+    //reads one pixel of a supported order as a color (alpha is used for orders without alpha)
+    inline color::Color load_color(const uint8_t *pixel, base::channel_order order, uint8_t alpha = 255){
+        layout l = layout_of(order);
+        return color::set_col(pixel[l.red], pixel[l.green], pixel[l.blue], l.alpha == 0xff ? alpha : pixel[l.alpha]);
+    }
+
+    //converts count pixels from src_order to dst_order, pixels without alpha get alpha
+    //src and dst may be the same buffer if both orders have the same pixel size
+    //returns false (and does nothing) if one of the orders isn't supported
+    inline bool convert_row(const uint8_t *src, base::channel_order src_order, uint8_t *dst, base::channel_order dst_order, size_t count, uint8_t alpha = 255){
+        if(!is_supported(src_order) || !is_supported(dst_order))
+            return false;
+        uint8_t map[4];
+        make_map(src_order, dst_order, map);
+        simd::shuffle_pixels(src, bytes_per_pixel(src_order), dst, bytes_per_pixel(dst_order), map, alpha, count);
+        return true;
+    }
+
+    //copies the whole image into dst, as pixels in dst_order (has to be supported), rows are dst_stride bytes apart
+    //(0 = no padding), dst has to have room for get_height() rows, pixels without alpha get alpha
+    template<typename Image>
+    inline bool to_buffer(Image &img, uint8_t *dst, base::channel_order dst_order, size_t dst_stride = 0, uint8_t alpha = 255){
+        if(!img.is_initialized() || !dst || !is_supported(dst_order))
+            return false;
+        uint32_t width = img.get_width(), height = img.get_height();
+        if(!dst_stride)
+            dst_stride = (size_t)width * bytes_per_pixel(dst_order);
+
+        base::channel_order src_order = img.get_channel_order();
+        std::vector<const uint8_t*> rows;
+        if(is_supported(src_order) && base::get_rows(img, rows)){
+            base::for_each_band(height, (uint64_t)width * height, [&](uint32_t first, uint32_t end){
+                for(uint32_t y = first; y < end; y++){
+                    convert_row(rows[y], src_order, dst + y * dst_stride, dst_order, width, alpha);
+                }
+            });
+            return true;
+        }
+        bool fill_alpha = lacks_alpha(src_order);
+        for(uint32_t y = 0; y < height; y++){
+            for(uint32_t x = 0; x < width; x++){
+                color::Color col = base::fetch_pixel(img, x, y);
+                if(fill_alpha)
+                    color::set_alpha(col, alpha);
+                store_color(dst + y * dst_stride + (size_t)x * bytes_per_pixel(dst_order), dst_order, col);
+            }
+        }
+        return true;
+    }
+
+    //fills the whole image with the pixels of src, which are in src_order (has to be supported), rows are src_stride bytes apart
+    //(0 = no padding), src has to have get_height() rows, pixels without alpha get alpha
+    template<typename Image>
+    inline bool from_buffer(Image &img, const uint8_t *src, base::channel_order src_order, size_t src_stride = 0, uint8_t alpha = 255){
+        if(!img.is_initialized() || !src || !is_supported(src_order) || !base::make_writable(img))
+            return false;
+        uint32_t width = img.get_width(), height = img.get_height();
+        if(!src_stride)
+            src_stride = (size_t)width * bytes_per_pixel(src_order);
+
+        base::channel_order dst_order = img.get_channel_order();
+        std::vector<uint8_t*> rows;
+        if(is_supported(dst_order) && base::get_rows(img, rows)){
+            base::for_each_band(height, (uint64_t)width * height, [&](uint32_t first, uint32_t end){
+                for(uint32_t y = first; y < end; y++){
+                    convert_row(src + y * src_stride, src_order, rows[y], dst_order, width, alpha);
+                }
+            });
+            return true;
+        }
+        for(uint32_t y = 0; y < height; y++){
+            for(uint32_t x = 0; x < width; x++){
+                base::put_pixel(img, x, y, load_color(src + y * src_stride + (size_t)x * bytes_per_pixel(src_order), src_order, alpha));
+            }
+        }
+        return true;
+    }
+
+    //copies src into dst, which has to have the same size, converting the channel order on the way (see top of the file)
+    //dst can be a view, so an image can be converted into a part of a larger one
+    template<typename Dst, typename Src>
+    inline bool convert(Src &src, Dst &dst, uint8_t alpha = 255){
+        if(!src.is_initialized() || !dst.is_initialized() || src.get_width() != dst.get_width() || src.get_height() != dst.get_height())
+            return false;
+        uint32_t width = src.get_width(), height = src.get_height();
+        base::channel_order src_order = src.get_channel_order(), dst_order = dst.get_channel_order();
+        std::vector<const uint8_t*> src_rows;
+        std::vector<uint8_t*> dst_rows;
+        //src is only read, if dst is a copy of src (copy on write) only dst gets pixels of its own
+        if(is_supported(src_order) && is_supported(dst_order) && base::get_rows(src, src_rows) && base::make_writable(dst) && base::get_rows(dst, dst_rows)){
+            base::for_each_band(height, (uint64_t)width * height, [&](uint32_t first, uint32_t end){
+                for(uint32_t y = first; y < end; y++){
+                    convert_row(src_rows[y], src_order, dst_rows[y], dst_order, width, alpha);
+                }
+            });
+            return true;
+        }
+        if(!base::make_writable(dst))
+            return false;
+        bool fill_alpha = lacks_alpha(src_order);
+        for(uint32_t y = 0; y < height; y++){
+            for(uint32_t x = 0; x < width; x++){
+                color::Color col = base::fetch_pixel(src, x, y);
+                if(fill_alpha)
+                    color::set_alpha(col, alpha);
+                base::put_pixel(dst, x, y, col);
+            }
+        }
+        return true;
+    }
+}
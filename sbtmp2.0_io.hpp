@@ -0,0 +1,1048 @@
+/*
+ *  I/O helpers for Simple Bitmap 2.0
+ *
+ *  Everything that is needed to get image data in and out of files, without every format having
+ *  to reinvent it. The format classes include this file instead of the base file directly.
+ *
+ *  Currently contains:
+ *      -sinks and sources, so the encoders/decoders work the same on files and memory buffers
+ *      -a BMP/DIB header parser that works on raw memory
+ *      -memory mapped files (only on POSIX systems, mapping simply fails everywhere else)
+ *      -a buffered row writer that writes padded BMP rows in large blocks
+ *      -a region reader that only reads the part of a BMP file that is actually needed
+ *      -a generic decoder for palette, RLE8, RLE4 and BI_BITFIELDS bitmaps and an RLE8/RLE4 encoder
+ */
+
+
+#pragma once
+
+#include "sbtmp2.0_base.hpp"
+#include "sbtmp2.0_memory.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+
+namespace sbtmp::io {
+
+    //compression types of the DIB header
+    constexpr uint32_t bi_rgb = 0;
+    constexpr uint32_t bi_rle8 = 1;
+    constexpr uint32_t bi_rle4 = 2;
+    constexpr uint32_t bi_bitfields = 3;
+    constexpr uint32_t bi_alphabitfields = 6;
+
+    //everything we need to know from the BMP and DIB header to find and interpret the pixel data
+    struct bmp_info{
+        uint32_t file_size = 0;
+        uint32_t pixel_data_offset = 0;
+        uint32_t DIB_header_size = 0;
+        int32_t width = 0, height = 0; //height is always positive, see top_down
+        bool top_down = false; //the file had a negative height, its first row is the top of the image
+        uint16_t bits_per_pixel = 0;
+        uint32_t compression = 0;
+        uint32_t raw_data_size = 0;
+        uint32_t colors_used = 0;
+        //channel masks, only used by BI_BITFIELDS images
+        uint32_t red_mask = 0, green_mask = 0, blue_mask = 0, alpha_mask = 0;
+    };
+
+    //reads a value from a byte buffer (BMP files are little endian, just like every machine this runs on)
+    template<typename T>
+    inline T read_le(const uint8_t *buf){
+        T val;
+        memcpy(&val, buf, sizeof(T));
+        return val;
+    }
+
+    //writes a value into a byte buffer (counterpart to read_le)
+    template<typename T>
+    inline void put_le(uint8_t *buf, T val){
+        memcpy(buf, &val, sizeof(T));
+    }
+
+    //size of one row in a BMP file, rows are always padded to a multiple of 4 bytes
+    constexpr size_t bmp_row_stride(uint32_t width, uint16_t bits_per_pixel){
+        return (((size_t)width * bits_per_pixel + 31) / 32) * 4;
+    }
+
+    //something an encoder can write to
+    class sink{
+        public:
+        virtual ~sink() = default;
+
+        //appends size bytes, returns false if they couldn't be written
+        virtual bool write(const uint8_t *buf, size_t size) = 0;
+
+        //returns memory for the next size bytes that can be filled directly (they count as written)
+        //sinks that don't own any memory return nullptr, write has to be used then
+        virtual uint8_t *direct(size_t size){
+            return nullptr;
+        }
+    };
+
+    //writes to a stream (usually a file)
+    class stream_sink : public sink{
+        public:
+        stream_sink(std::ostream &set_out) : out(set_out) {}
+
+        bool write(const uint8_t *buf, size_t size) override {
+            out.write((const char*)buf, size);
+            return out.good();
+        }
+
+        private:
+        std::ostream &out;
+    };
+
+    //writes to memory, either a vector that grows as needed or a fixed buffer from the caller
+    class buffer_sink : public sink{
+        public:
+        //appends to the vector
+        buffer_sink(std::vector<uint8_t> &set_vec) : vec(&set_vec) {}
+
+        //writes into buf, fails as soon as capacity bytes are exceeded
+        buffer_sink(uint8_t *set_buf, size_t set_capacity) : buf(set_buf), capacity(set_capacity) {}
+
+        bool write(const uint8_t *data, size_t size) override {
+            uint8_t *dst = direct(size);
+            if(!dst)
+                return false;
+            memcpy(dst, data, size);
+            return true;
+        }
+
+        uint8_t *direct(size_t size) override {
+            if(vec){
+                size_t old_size = vec->size();
+                vec->resize(old_size + size);
+                return vec->data() + old_size;
+            }
+            if(!buf || size > capacity - written)
+                return nullptr;
+            written += size;
+            return buf + written - size;
+        }
+
+        //number of bytes written into the fixed buffer
+        size_t size(){
+            return vec ? vec->size() : written;
+        }
+
+        private:
+        std::vector<uint8_t> *vec = nullptr;
+        uint8_t *buf = nullptr;
+        size_t capacity = 0, written = 0;
+    };
+
+    //something a decoder can read from
+    class source{
+        public:
+        virtual ~source() = default;
+
+        //reads size bytes starting at offset, returns false if there aren't enough
+        virtual bool read_at(uint64_t offset, uint8_t *buf, size_t size) = 0;
+
+        //total number of bytes available
+        virtual uint64_t size() = 0;
+    };
+
+    //reads from a stream (usually a file)
+    class stream_source : public source{
+        public:
+        stream_source(std::istream &set_in) : in(set_in) {
+            in.seekg(0, std::ios::end);
+            length = in ? (uint64_t)in.tellg() : 0;
+        }
+
+        bool read_at(uint64_t offset, uint8_t *buf, size_t size) override {
+            if(offset + size > length)
+                return false;
+            in.seekg(offset);
+            return (bool)in.read((char*)buf, size);
+        }
+
+        uint64_t size() override {
+            return length;
+        }
+
+        private:
+        std::istream &in;
+        uint64_t length = 0;
+    };
+
+    //reads from a memory buffer
+    class memory_source : public source{
+        public:
+        memory_source(const uint8_t *set_buf, size_t set_size) : buf(set_buf), length(set_buf ? set_size : 0) {}
+
+        bool read_at(uint64_t offset, uint8_t *dst, size_t size) override {
+            if(offset + size > length)
+                return false;
+            memcpy(dst, buf + offset, size);
+            return true;
+        }
+
+        uint64_t size() override {
+            return length;
+        }
+
+        private:
+        const uint8_t *buf;
+        uint64_t length;
+    };
+
+    //parses the BMP file header and the part of the DIB header that every version has in common
+    //(plus the channel masks, if the buffer is large enough to contain them)
+    //works with BITMAPINFOHEADER and the larger V2 to V5 headers, the fields they add (besides the masks) are not needed
+    //returns false if the buffer doesn't contain a BMP header
+    inline bool parse_bmp_header(const uint8_t *buf, size_t size, bmp_info &info){
+        //14 bytes BMP header + 40 bytes BITMAPINFOHEADER
+        if(!buf || size < 54 || buf[0] != 'B' || buf[1] != 'M')
+            return false;
+
+        info.file_size          = read_le<uint32_t>(buf + 2);
+        info.pixel_data_offset  = read_le<uint32_t>(buf + 10);
+        info.DIB_header_size    = read_le<uint32_t>(buf + 14);
+        info.width              = read_le<int32_t>(buf + 18);
+        info.height             = read_le<int32_t>(buf + 22);
+        info.bits_per_pixel     = read_le<uint16_t>(buf + 28);
+        info.compression        = read_le<uint32_t>(buf + 30);
+        info.raw_data_size      = read_le<uint32_t>(buf + 34);
+        info.colors_used        = read_le<uint32_t>(buf + 46);
+
+        //a negative height means the rows are stored top down
+        info.top_down = info.height < 0;
+        if(info.top_down){
+            if(info.height == INT32_MIN)
+                return false;
+            info.height = -info.height;
+        }
+
+        //the channel masks follow the 40 byte header (or are part of the newer and larger headers)
+        if((info.compression == bi_bitfields || info.compression == bi_alphabitfields) && size >= 66){
+            info.red_mask   = read_le<uint32_t>(buf + 54);
+            info.green_mask = read_le<uint32_t>(buf + 58);
+            info.blue_mask  = read_le<uint32_t>(buf + 62);
+            if((info.DIB_header_size >= 56 || info.compression == bi_alphabitfields) && size >= 70)
+                info.alpha_mask = read_le<uint32_t>(buf + 66);
+        }
+
+        if(info.DIB_header_size < 40 || info.pixel_data_offset < 14 + info.DIB_header_size)
+            return false;
+        //compressed images are always bottom up
+        if(info.top_down && (info.compression == bi_rle8 || info.compression == bi_rle4))
+            return false;
+
+        return true;
+    }
+
+    //a file mapped into memory
+    //the mapping is released when the object is destroyed
+    class mapped_file{
+        public:
+
+        mapped_file() = default;
+
+        //a mapping can't be copied, only moved
+        mapped_file(const mapped_file &) = delete;
+        mapped_file &operator=(const mapped_file &) = delete;
+
+        mapped_file(mapped_file &&other) noexcept{
+            base = other.base;
+            length = other.length;
+            other.base = nullptr;
+            other.length = 0;
+        }
+
+        mapped_file &operator=(mapped_file &&other) noexcept{
+            if(this != &other){
+                unmap();
+                base = other.base;
+                length = other.length;
+                other.base = nullptr;
+                other.length = 0;
+            }
+            return *this;
+        }
+
+        ~mapped_file(){
+            unmap();
+        }
+
+        //maps the whole file into memory
+        //write_back = true: changes to the memory end up in the file
+        //write_back = false: the memory is still writable, but changes are private and the file stays untouched
+        bool map(const char *filename, bool write_back){
+            if(base)
+                return false;
+        #ifdef sbtmp_has_mmap
+            int fd = open(filename, write_back ? O_RDWR : O_RDONLY);
+            if(fd < 0)
+                return false;
+
+            struct stat st;
+            if(fstat(fd, &st) != 0 || st.st_size <= 0){
+                close(fd);
+                return false;
+            }
+
+            void *addr = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, write_back ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+            //the mapping keeps its own reference to the file
+            close(fd);
+            if(addr == MAP_FAILED)
+                return false;
+
+            base = (uint8_t*)addr;
+            length = (size_t)st.st_size;
+            return true;
+        #else
+            (void)filename;
+            (void)write_back;
+            return false;
+        #endif
+        }
+
+        //releases the mapping (changes of a write back mapping are kept by the OS)
+        void unmap(){
+            if(!base)
+                return;
+        #ifdef sbtmp_has_mmap
+            munmap(base, length);
+        #endif
+            base = nullptr;
+            length = 0;
+        }
+
+        //blocks until all changes have been written to the file
+        bool sync(){
+            if(!base)
+                return false;
+        #ifdef sbtmp_has_mmap
+            return msync(base, length, MS_SYNC) == 0;
+        #else
+            return false;
+        #endif
+        }
+
+        uint8_t *data(){
+            return base;
+        }
+
+        size_t size(){
+            return length;
+        }
+
+        bool is_mapped() const {
+            return base != nullptr;
+        }
+
+        private:
+        uint8_t *base = nullptr;
+        size_t length = 0;
+    };
+
+    //size of the blocks the row writer hands to the stream (multiple of the page size)
+    constexpr size_t write_block_size = 1 << 20;
+
+    //writes rows of pixel data and adds the BMP padding to every row
+    //instead of writing byte by byte, the padded rows are collected in one large aligned block
+    //which is then written at once, so the stream overhead is paid once per megabyte and not once per byte
+    //sinks with their own memory get the padded rows directly, without the extra block
+    //row_size: bytes of pixel data per row, src_stride: distance between two rows in memory
+    //(a negative stride walks the rows backwards, src then has to point to the first row that is written)
+    //callers that write a few rows at a time (BitmapWriter) pass a block of their own, block_size has to hold at least one
+    //padded row, without one a block is allocated for every call
+    inline bool write_padded_rows(sink &out, const uint8_t *src, size_t row_size, ptrdiff_t src_stride, uint32_t rows, uint8_t *block = nullptr, size_t block_size = 0){
+        size_t file_stride = (row_size + 3) & ~(size_t)3;
+
+        //the rows already have the layout of the file (padding included), the data can be written as it is
+        if(src_stride == (ptrdiff_t)file_stride)
+            return out.write(src, file_stride * rows);
+
+        //copy rows into dst and zero the padding bytes
+        auto pad_rows = [&](uint8_t *dst, uint32_t first, uint32_t count){
+            for(uint32_t y = first; y < first + count; y++){
+                memcpy(dst, src + (ptrdiff_t)y * src_stride, row_size);
+                memset(dst + row_size, 0, file_stride - row_size);
+                dst += file_stride;
+            }
+        };
+
+        if(uint8_t *dst = out.direct(file_stride * rows)){
+            pad_rows(dst, 0, rows);
+            return true;
+        }
+
+        //at least one row has to fit into the block
+        bool own_block = !block || block_size < file_stride;
+        if(own_block){
+            block_size = std::max(write_block_size, (file_stride + 4095) & ~(size_t)4095);
+            block = memory::alloc_aligned(block_size, 4096);
+            if(!block)
+                return false;
+        }
+
+        uint32_t rows_per_block = block_size / file_stride;
+        bool ok = true;
+        for(uint32_t y = 0; y < rows && ok; y += rows_per_block){
+            uint32_t count = std::min(rows_per_block, rows - y);
+            pad_rows(block, y, count);
+            ok = out.write(block, count * file_stride);
+        }
+
+        if(own_block)
+            memory::free_aligned(block);
+        return ok;
+    }
+
+    //reads the BMP header from the start of a source
+    inline bool read_bmp_header(source &in, bmp_info &info){
+        //54 bytes for the headers and up to 16 bytes of channel masks
+        uint8_t header[70];
+        size_t size = std::min((uint64_t)sizeof(header), in.size());
+        if(!in.read_at(0, header, size))
+            return false;
+        return parse_bmp_header(header, size, info);
+    }
+
+    //reads a rectangle of uncompressed pixel data from a BMP file
+    //x and y are image coordinates (y = 0 is the top row), the rows end up in dst in the same order as in the file
+    //(bottom up or top down)
+    //only the rows inside the rectangle are read, if the rectangle spans whole rows and dst has the same row layout
+    //as the file (dst_stride is the file's stride, padding included) it is read in one go
+    inline bool read_bmp_region(source &in, const bmp_info &info, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t *dst, size_t dst_stride){
+        if(info.width <= 0 || info.height <= 0 || info.bits_per_pixel % 8 != 0)
+            return false;
+        if(width == 0 || height == 0 || (uint64_t)x + width > (uint32_t)info.width || (uint64_t)y + height > (uint32_t)info.height)
+            return false;
+
+        size_t bytes_per_pixel = info.bits_per_pixel / 8;
+        size_t file_stride = bmp_row_stride(info.width, info.bits_per_pixel);
+        size_t row_size = width * bytes_per_pixel;
+
+        //check if the source actually contains all of the pixel data
+        if(info.pixel_data_offset + (uint64_t)file_stride * info.height > in.size())
+            return false;
+
+        //first row of the rectangle in the file
+        uint32_t first_file_row = info.top_down ? y : info.height - y - height;
+        uint64_t pos = info.pixel_data_offset + (uint64_t)first_file_row * file_stride + x * bytes_per_pixel;
+
+        //the rectangle is one continuous block of the file
+        if(x == 0 && width == (uint32_t)info.width && dst_stride == file_stride)
+            return in.read_at(pos, dst, file_stride * height);
+
+        for(uint32_t row = 0; row < height; row++){
+            if(!in.read_at(pos + row * file_stride, dst + row * dst_stride, row_size))
+                return false;
+        }
+        return true;
+    }
+
+    //reads the color table of a palette image as BGRA colors (alpha is always 255)
+    //returns the number of colors in the table, 0 if it couldn't be read
+    inline uint32_t read_bmp_palette(source &in, const bmp_info &info, uint32_t palette[256]){
+        if(info.bits_per_pixel > 8)
+            return 0;
+        uint32_t count = info.colors_used ? info.colors_used : 1u << info.bits_per_pixel;
+        if(count > 256)
+            return 0;
+
+        //the table follows the DIB header (and the channel masks, which only exist for BI_BITFIELDS images)
+        uint8_t table[256 * 4];
+        if(!in.read_at(14 + info.DIB_header_size, table, count * 4))
+            return 0;
+        for(uint32_t i = 0; i < count; i++){
+            palette[i] = read_le<uint32_t>(table + i * 4) | 0xff000000;
+        }
+        //indices outside of the table are black
+        for(uint32_t i = count; i < 256; i++){
+            palette[i] = 0xff000000;
+        }
+        return count;
+    }
+
+    //position and size of one channel in a BI_BITFIELDS pixel
+    struct bitfield{
+        uint32_t mask = 0;
+        uint8_t shift = 0;
+        uint32_t max = 0;
+
+        bitfield(uint32_t set_mask) : mask(set_mask) {
+            if(!mask)
+                return;
+            while(!((mask >> shift) & 1)){
+                shift++;
+            }
+            max = mask >> shift;
+        }
+
+        //extracts the channel and scales it to 8 bits
+        uint8_t get(uint32_t pixel, uint8_t missing) const {
+            if(!mask)
+                return missing;
+            uint32_t val = (pixel & mask) >> shift;
+            return max == 255 ? val : ((uint64_t)val * 255 + max / 2) / max;
+        }
+    };
+
+    //decodes a window of an RLE8 or RLE4 bitmap into BGRA pixels
+    //the window is width * height pixels, starting at column x and at row first_row of the file (rows are bottom up, like in
+    //the file), RLE rows only ever move forward, so they are decoded into a single row that is handed to
+    //row_done(row, pixels) (row 0 = first row of the window) once the stream moves past it
+    //decoding stops after the last row of the window, pixels the file skips are black
+    template<typename RowDone>
+    inline bool decode_bmp_rle(const uint8_t *src, size_t size, const bmp_info &info, const uint32_t palette[256], uint32_t x, uint32_t first_row, uint32_t width, uint32_t height, RowDone &&row_done){
+        bool rle4 = info.compression == bi_rle4;
+        uint64_t last_col = (uint64_t)x + width, last_row = (uint64_t)first_row + height;
+        //position in the image, 64 bit so runs and deltas can't wrap around into the window again
+        uint64_t col = 0, row = 0;
+        size_t pos = 0;
+        std::vector<uint32_t> line(width);
+
+        auto put = [&](uint8_t index){
+            if(col >= x && col < last_col && row >= first_row)
+                line[col - x] = palette[index];
+            col++;
+        };
+        //moves on to row next, the rows of the window that are left behind are done
+        auto skip_rows = [&](uint64_t next){
+            for(; row < next && row < last_row; row++){
+                if(row < first_row)
+                    continue;
+                row_done((uint32_t)(row - first_row), (const uint8_t*)line.data());
+                std::fill(line.begin(), line.end(), 0);
+            }
+            row = next;
+        };
+
+        while(pos + 1 < size && row < last_row){
+            uint8_t count = src[pos], val = src[pos + 1];
+            pos += 2;
+
+            if(count > 0){
+                //encoded run
+                if(!rle4){
+                    //fill the part of the run inside the window at once instead of going through put
+                    uint64_t first = std::max<uint64_t>(col, x), end = std::min<uint64_t>(col + count, last_col);
+                    if(row >= first_row && first < end)
+                        std::fill(line.begin() + (first - x), line.begin() + (end - x), palette[val]);
+                    col += count;
+                }
+                else{
+                    //RLE4 runs alternate between the two indices in val
+                    for(uint8_t i = 0; i < count; i++){
+                        put((i & 1) ? (val & 0x0f) : (val >> 4));
+                    }
+                }
+                continue;
+            }
+
+            switch(val){
+                case 0: //end of line
+                    col = 0;
+                    skip_rows(row + 1);
+                    break;
+                case 1: //end of bitmap
+                    pos = size;
+                    break;
+                case 2: //delta
+                    if(pos + 1 >= size)
+                        return false;
+                    col += src[pos];
+                    skip_rows(row + src[pos + 1]);
+                    pos += 2;
+                    break;
+                default:{ //absolute run of val uncompressed indices, padded to 16 bits
+                    size_t bytes = rle4 ? (val + 1) / 2 : val;
+                    if(pos + bytes > size)
+                        return false;
+                    for(uint8_t i = 0; i < val; i++){
+                        if(rle4)
+                            put((i & 1) ? (src[pos + i / 2] & 0x0f) : (src[pos + i / 2] >> 4));
+                        else
+                            put(src[pos + i]);
+                    }
+                    pos += (bytes + 1) & ~(size_t)1;
+                    break;
+                }
+            }
+        }
+        //the rest of the window is black (some encoders also leave out the end of bitmap marker)
+        skip_rows(last_row);
+        return true;
+    }
+
+    //size of the compressed pixel data of an RLE8 or RLE4 file
+    inline uint64_t bmp_rle_data_size(source &in, const bmp_info &info){
+        if(info.pixel_data_offset >= in.size())
+            return 0;
+        uint64_t size = in.size() - info.pixel_data_offset;
+        if(info.raw_data_size && info.raw_data_size < size)
+            size = info.raw_data_size;
+        return size;
+    }
+
+    //returns false if the source is too small to hold the pixel data of the image the header describes
+    //uncompressed files need every row, an RLE command moves at most 255 pixels or rows on, so a compressed stream
+    //can't get further than 255 pixels or rows per 2 bytes, files claiming more are broken (or made to use up memory)
+    inline bool bmp_data_fits(source &in, const bmp_info &info){
+        if(info.width <= 0 || info.height <= 0)
+            return false;
+        if(info.compression == bi_rle8 || info.compression == bi_rle4){
+            uint64_t reach = bmp_rle_data_size(in, info) / 2 * 255;
+            return (uint64_t)info.width <= reach && (uint64_t)info.height <= reach;
+        }
+        return info.pixel_data_offset + (uint64_t)bmp_row_stride(info.width, info.bits_per_pixel) * info.height <= in.size();
+    }
+
+    //converts the pixels of uncompressed BMP rows to BGR or BGRA
+    //supported are 1, 4, 8 bit palette images, 16 and 32 bit BI_BITFIELDS images and uncompressed 16 (555), 24 and 32 bit images
+    class bmp_row_converter{
+        public:
+
+        //reads the palette and the channel masks, returns false if the file isn't one of the supported formats
+        bool setup(source &in, const bmp_info &info){
+            bits = info.bits_per_pixel;
+            bool has_masks = info.compression == bi_bitfields || info.compression == bi_alphabitfields;
+            if(info.compression != bi_rgb && !has_masks)
+                return false;
+            if(bits <= 8 && (has_masks || (bits != 1 && bits != 4 && bits != 8) || !read_bmp_palette(in, info, palette)))
+                return false;
+            if(bits > 8 && bits != 16 && bits != 24 && bits != 32)
+                return false;
+            if(has_masks && bits != 16 && bits != 32)
+                return false;
+
+            //uncompressed 16 bit images use 5 bits per channel
+            red = bitfield(has_masks ? info.red_mask : (bits == 16 ? 0x7c00 : 0x00ff0000));
+            green = bitfield(has_masks ? info.green_mask : (bits == 16 ? 0x03e0 : 0x0000ff00));
+            blue = bitfield(has_masks ? info.blue_mask : (bits == 16 ? 0x001f : 0x000000ff));
+            alpha = bitfield(has_masks ? info.alpha_mask : 0);
+            return true;
+        }
+
+        //byte of a file row that contains pixel x and the number of bytes that contain the pixels x to x + count
+        size_t first_byte(uint32_t x) const {
+            return (size_t)x * bits / 8;
+        }
+        size_t byte_count(uint32_t x, uint32_t count) const {
+            return ((size_t)(x + count) * bits + 7) / 8 - first_byte(x);
+        }
+
+        //converts count pixels of a file row to out (out_bpp 3 = BGR, 4 = BGRA)
+        //row points to first_byte(x) of the file row, x is the image column of the first pixel
+        void convert(const uint8_t *row, uint32_t x, uint32_t count, uint8_t *out, uint8_t out_bpp) const {
+            if(bits <= 8){
+                uint8_t pixels_per_byte = 8 / bits;
+                uint8_t index_mask = (1 << bits) - 1;
+                //pixel x is somewhere inside the first byte of row
+                uint32_t skip = x % pixels_per_byte;
+                for(uint32_t i = 0; i < count; i++){
+                    uint32_t pos = skip + i;
+                    uint8_t shift = (pixels_per_byte - 1 - pos % pixels_per_byte) * bits;
+                    const uint8_t *col = (const uint8_t*)&palette[(row[pos / pixels_per_byte] >> shift) & index_mask];
+                    memcpy(out + (size_t)i * out_bpp, col, out_bpp);
+                }
+            }
+            else if(bits == 24){
+                for(uint32_t i = 0; i < count; i++){
+                    out[i * out_bpp + 0] = row[i * 3 + 0];
+                    out[i * out_bpp + 1] = row[i * 3 + 1];
+                    out[i * out_bpp + 2] = row[i * 3 + 2];
+                    if(out_bpp == 4)
+                        out[i * 4 + 3] = 255;
+                }
+            }
+            else{
+                for(uint32_t i = 0; i < count; i++){
+                    uint32_t pixel = (bits == 16) ? read_le<uint16_t>(row + i * 2) : read_le<uint32_t>(row + i * 4);
+                    out[i * out_bpp + 0] = blue.get(pixel, 0);
+                    out[i * out_bpp + 1] = green.get(pixel, 0);
+                    out[i * out_bpp + 2] = red.get(pixel, 0);
+                    if(out_bpp == 4)
+                        out[i * 4 + 3] = alpha.get(pixel, 255);
+                }
+            }
+        }
+
+        private:
+        uint16_t bits = 0;
+        uint32_t palette[256];
+        bitfield red = 0, green = 0, blue = 0, alpha = 0;
+    };
+
+    //reads the compressed pixel data of an RLE8 or RLE4 file and decodes a window of it into BGRA rows (see decode_bmp_rle)
+    template<typename RowDone>
+    inline bool decode_bmp_rle_rows(source &in, const bmp_info &info, uint32_t x, uint32_t first_row, uint32_t width, uint32_t height, RowDone &&row_done){
+        if(info.bits_per_pixel != (info.compression == bi_rle8 ? 8 : 4) || !bmp_data_fits(in, info))
+            return false;
+        uint32_t palette[256];
+        if(!read_bmp_palette(in, info, palette))
+            return false;
+
+        //the compressed data is usually a lot smaller than the image, so it is read in one go
+        uint64_t size = bmp_rle_data_size(in, info);
+        std::vector<uint8_t> data(size);
+        if(!in.read_at(info.pixel_data_offset, data.data(), size))
+            return false;
+        return decode_bmp_rle(data.data(), size, info, palette, x, first_row, width, height, row_done);
+    }
+
+    //decodes the pixel data of any supported BMP file into BGRA pixels (rows in the same order as in the file)
+    //supported are RLE8, RLE4 and everything bmp_row_converter understands
+    //dst must have room for width * height * 4 bytes
+    inline bool decode_bmp_bgra(source &in, const bmp_info &info, uint8_t *dst){
+        if(info.width <= 0 || info.height <= 0)
+            return false;
+        if(info.compression == bi_rle8 || info.compression == bi_rle4)
+            return decode_bmp_rle_rows(in, info, 0, 0, info.width, info.height, [&](uint32_t y, const uint8_t *pixels){
+                memcpy(dst + (size_t)y * info.width * 4, pixels, (size_t)info.width * 4);
+            });
+
+        bmp_row_converter converter;
+        if(!converter.setup(in, info))
+            return false;
+        uint32_t width = info.width, height = info.height;
+        size_t file_stride = bmp_row_stride(width, info.bits_per_pixel);
+        if(info.pixel_data_offset + (uint64_t)file_stride * height > in.size())
+            return false;
+
+        std::vector<uint8_t> row(file_stride);
+        for(uint32_t y = 0; y < height; y++){
+            if(!in.read_at(info.pixel_data_offset + (uint64_t)y * file_stride, row.data(), file_stride))
+                return false;
+            converter.convert(row.data(), 0, width, dst + (size_t)y * width * 4, 4);
+        }
+        return true;
+    }
+
+    //like read_bmp_region, but works with every format decode_bmp_bgra understands, the pixels are converted to
+    //BGR (bytes_per_pixel = 3) or BGRA (4)
+    //the rows are handed out one by one in the same order as in the file: row_target(row) returns where row (0 = first
+    //row of the rectangle in the file) goes, row_done(row, pixels) is called once it is there
+    //for uncompressed files only the bytes of the rectangle are read, RLE files are decoded up to the last row of the rectangle
+    template<typename RowTarget, typename RowDone>
+    inline bool read_bmp_region_rows(source &in, const bmp_info &info, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t bytes_per_pixel, RowTarget &&row_target, RowDone &&row_done){
+        if(info.width <= 0 || info.height <= 0 || width == 0 || height == 0 || (uint64_t)x + width > (uint32_t)info.width || (uint64_t)y + height > (uint32_t)info.height)
+            return false;
+        uint32_t first_file_row = info.top_down ? y : info.height - y - height;
+
+        if(info.compression == bi_rle8 || info.compression == bi_rle4){
+            return decode_bmp_rle_rows(in, info, x, first_file_row, width, height, [&](uint32_t row, const uint8_t *src){
+                uint8_t *out = row_target(row);
+                if(bytes_per_pixel == 4)
+                    memcpy(out, src, (size_t)width * 4);
+                else{
+                    for(uint32_t i = 0; i < width; i++){
+                        out[i * 3 + 0] = src[i * 4 + 0];
+                        out[i * 3 + 1] = src[i * 4 + 1];
+                        out[i * 3 + 2] = src[i * 4 + 2];
+                    }
+                }
+                row_done(row, out);
+            });
+        }
+
+        bmp_row_converter converter;
+        if(!converter.setup(in, info))
+            return false;
+        size_t file_stride = bmp_row_stride(info.width, info.bits_per_pixel);
+        if(info.pixel_data_offset + (uint64_t)file_stride * info.height > in.size())
+            return false;
+
+        //only the bytes with the columns of the rectangle are read
+        uint64_t pos = info.pixel_data_offset + (uint64_t)first_file_row * file_stride + converter.first_byte(x);
+        std::vector<uint8_t> bytes(converter.byte_count(x, width));
+        for(uint32_t row = 0; row < height; row++){
+            if(!in.read_at(pos + (uint64_t)row * file_stride, bytes.data(), bytes.size()))
+                return false;
+            uint8_t *out = row_target(row);
+            converter.convert(bytes.data(), x, width, out, bytes_per_pixel);
+            row_done(row, out);
+        }
+        return true;
+    }
+
+    //read_bmp_region_rows straight into dst, rows are dst_stride bytes apart
+    inline bool read_bmp_region_converted(source &in, const bmp_info &info, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t *dst, size_t dst_stride, uint8_t bytes_per_pixel){
+        return read_bmp_region_rows(in, info, x, y, width, height, bytes_per_pixel,
+                                    [&](uint32_t row){ return dst + row * dst_stride; }, [](uint32_t, const uint8_t*){});
+    }
+
+    //number of equal pixels starting at pixels[0] (at most max)
+    inline uint32_t rle_run_length(const uint32_t *pixels, uint32_t max){
+        uint32_t len = 1;
+        while(len < max && pixels[len] == pixels[0]){
+            len++;
+        }
+        return len;
+    }
+
+    //encodes one row of palette indices with RLE8 or RLE4 (without the end of line marker)
+    inline void encode_rle_row(const uint8_t *indices, uint32_t width, bool rle4, std::vector<uint8_t> &out){
+        //runs of identical indices are compared as bytes, runs in RLE4 can also alternate between two indices
+        //but we only look for runs of one index, that's what flat images consist of
+        uint32_t x = 0;
+        while(x < width){
+            uint32_t max_run = std::min(width - x, 255u);
+            uint32_t run = 1;
+            while(run < max_run && indices[x + run] == indices[x]){
+                run++;
+            }
+
+            if(run >= 3 || width - x < 3){
+                out.push_back(run);
+                out.push_back(rle4 ? (indices[x] << 4 | indices[x]) : indices[x]);
+                x += run;
+                continue;
+            }
+
+            //collect literal indices until the next run of at least 3 starts
+            uint32_t start = x;
+            while(x < width && x - start < 255){
+                if(x + 2 < width && indices[x] == indices[x + 1] && indices[x] == indices[x + 2])
+                    break;
+                x++;
+            }
+            uint32_t count = x - start;
+            if(count < 3){
+                //absolute runs must have at least 3 indices, shorter ones are written as runs
+                for(uint32_t i = start; i < x;){
+                    uint32_t len = 1;
+                    while(i + len < x && indices[i + len] == indices[i]){
+                        len++;
+                    }
+                    out.push_back(len);
+                    out.push_back(rle4 ? (indices[i] << 4 | indices[i]) : indices[i]);
+                    i += len;
+                }
+                continue;
+            }
+
+            out.push_back(0);
+            out.push_back(count);
+            size_t bytes = rle4 ? (count + 1) / 2 : count;
+            for(uint32_t i = 0; i < count; i++){
+                if(!rle4)
+                    out.push_back(indices[start + i]);
+                else if(i % 2 == 0)
+                    out.push_back(indices[start + i] << 4 | (i + 1 < count ? indices[start + i + 1] : 0));
+            }
+            //absolute runs are padded to 16 bits
+            if(bytes % 2)
+                out.push_back(0);
+        }
+    }
+
+    //writes a palette image compressed with RLE8 (bits = 8) or RLE4 (bits = 4)
+    //pixels are read from the bottom up rows of src (bytes_per_pixel 3 = BGR, 4 = BGRA, alpha is ignored)
+    //RLE files can't be top down, for top down images pass the last row and a negative src_stride
+    //returns false if the image has more colors than the palette can hold (256 or 16)
+    inline bool encode_bmp_rle(sink &out, const uint8_t *src, uint32_t width, uint32_t height, uint8_t bytes_per_pixel, ptrdiff_t src_stride, uint16_t bits){
+        if((bits != 8 && bits != 4) || width == 0 || height == 0)
+            return false;
+        uint32_t max_colors = 1u << bits;
+
+        std::unordered_map<uint32_t, uint8_t> lookup;
+        uint32_t palette[256] = {0};
+        uint32_t colors = 0;
+
+        std::vector<uint32_t> row_pixels(width);
+        std::vector<uint8_t> indices(width);
+        std::vector<uint8_t> data;
+
+        for(uint32_t y = 0; y < height; y++){
+            const uint8_t *row = src + (ptrdiff_t)y * src_stride;
+            for(uint32_t x = 0; x < width; x++){
+                row_pixels[x] = row[x * bytes_per_pixel] | row[x * bytes_per_pixel + 1] << 8 | row[x * bytes_per_pixel + 2] << 16;
+            }
+
+            //find runs of equal pixels first, so every run only needs one palette lookup
+            for(uint32_t x = 0; x < width;){
+                uint32_t run = rle_run_length(&row_pixels[x], width - x);
+                auto it = lookup.find(row_pixels[x]);
+                uint8_t index;
+                if(it != lookup.end()){
+                    index = it->second;
+                }
+                else{
+                    if(colors == max_colors)
+                        return false;
+                    index = colors;
+                    palette[colors++] = row_pixels[x];
+                    lookup.emplace(row_pixels[x], index);
+                }
+                memset(&indices[x], index, run);
+                x += run;
+            }
+
+            encode_rle_row(indices.data(), width, bits == 4, data);
+            //end of line, the last one is replaced by end of bitmap
+            data.push_back(0);
+            data.push_back(y + 1 < height ? 0 : 1);
+        }
+
+        uint32_t offset = 54 + colors * 4;
+        uint64_t file_size = offset + data.size();
+        if(file_size > UINT32_MAX)
+            return false;
+
+        uint8_t header[54] = {0};
+        header[0] = 'B';
+        header[1] = 'M';
+        put_le(header + 2, (uint32_t)file_size);
+        put_le(header + 10, offset);
+        put_le(header + 14, (uint32_t)40); //DIB header size
+        put_le(header + 18, width);
+        put_le(header + 22, height);
+        put_le(header + 26, (uint16_t)1); //color planes
+        put_le(header + 28, bits);
+        put_le(header + 30, bits == 8 ? bi_rle8 : bi_rle4);
+        put_le(header + 34, (uint32_t)data.size());
+        put_le(header + 38, (uint32_t)2835); //DPI_hor
+        put_le(header + 42, (uint32_t)2835); //DPI_ver
+        put_le(header + 46, colors); //colors in the palette
+        put_le(header + 50, colors); //important colors
+
+        return out.write(header, sizeof(header)) && out.write((uint8_t*)palette, colors * 4) && out.write(data.data(), data.size());
+    }
+
+    //everything we need to know from the header of a binary Netpbm file (P4, P5, P6)
+    struct netpbm_info{
+        char type = 0; //'4' = PBM, '5' = PGM, '6' = PPM
+        uint32_t width = 0, height = 0;
+        uint32_t max_value = 1; //largest sample value, always 1 for PBM
+        uint64_t pixel_data_offset = 0;
+        uint64_t pixel_data_size = 0; //bytes of pixel data the header asks for, see netpbm_data_fits
+    };
+
+    //number of bytes of one row of pixel data in a binary Netpbm file
+    constexpr size_t netpbm_row_size(char type, uint32_t width, uint32_t max_value){
+        if(type == '4')
+            return ((size_t)width + 7) / 8; //8 pixels per byte, rows start at a new byte
+        return (size_t)width * (type == '6' ? 3 : 1) * (max_value > 255 ? 2 : 1);
+    }
+
+    //reads the header of a binary Netpbm file from the start of a source
+    //the header is plain text: magic number, width, height and max value (not for PBM), separated by whitespace
+    //lines starting with # are comments, a single whitespace character separates the header from the pixel data
+    inline bool read_netpbm_header(source &in, netpbm_info &info){
+        //headers are short, unless someone writes a novel into the comments
+        uint8_t header[1024];
+        size_t size = std::min((uint64_t)sizeof(header), in.size());
+        if(size < 3 || !in.read_at(0, header, size))
+            return false;
+        if(header[0] != 'P' || (header[1] != '4' && header[1] != '5' && header[1] != '6'))
+            return false;
+        info.type = header[1];
+
+        size_t pos = 2;
+        auto is_space = [](uint8_t c){ return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f'; };
+
+        //reads the next decimal number of the header, skips whitespace and comments before it
+        auto next_number = [&](uint32_t &val){
+            while(pos < size && (is_space(header[pos]) || header[pos] == '#')){
+                if(header[pos] == '#'){
+                    while(pos < size && header[pos] != '\n' && header[pos] != '\r')
+                        pos++;
+                }
+                else
+                    pos++;
+            }
+            if(pos >= size || header[pos] < '0' || header[pos] > '9')
+                return false;
+            uint64_t num = 0;
+            while(pos < size && header[pos] >= '0' && header[pos] <= '9'){
+                num = num * 10 + (header[pos++] - '0');
+                if(num > UINT32_MAX)
+                    return false;
+            }
+            val = num;
+            return true;
+        };
+
+        if(!next_number(info.width) || !next_number(info.height))
+            return false;
+        info.max_value = 1;
+        if(info.type != '4' && !next_number(info.max_value))
+            return false;
+
+        //exactly one whitespace character ends the header
+        if(pos >= size || !is_space(header[pos]))
+            return false;
+        info.pixel_data_offset = pos + 1;
+
+        if(info.width == 0 || info.height == 0 || info.max_value == 0 || info.max_value > 65535)
+            return false;
+
+        //the header can claim any size, the pixel data (and the smaller image made of it) has to be addressable with size_t
+        uint64_t row_size = info.type == '4' ? ((uint64_t)info.width + 7) / 8 : (uint64_t)info.width * (info.type == '6' ? 3 : 1) * (info.max_value > 255 ? 2 : 1);
+        if(row_size > SIZE_MAX / info.height)
+            return false;
+        info.pixel_data_size = row_size * info.height;
+        return true;
+    }
+
+    //returns false if the source is too small to hold the pixel data the header asks for, check it before allocating the image
+    inline bool netpbm_data_fits(source &in, const netpbm_info &info){
+        return info.pixel_data_size && info.pixel_data_offset + info.pixel_data_size <= in.size();
+    }
+
+    //writes the header of a binary Netpbm file, max_value is ignored for PBM
+    inline bool write_netpbm_header(sink &out, char type, uint32_t width, uint32_t height, uint32_t max_value){
+        char header[64];
+        int length = (type == '4') ? snprintf(header, sizeof(header), "P4\n%u %u\n", width, height) : snprintf(header, sizeof(header), "P%c\n%u %u\n%u\n", type, width, height, max_value);
+        return out.write((const uint8_t*)header, length);
+    }
+
+    //number of bytes a binary Netpbm file with 8 bit samples (1 bit for PBM) has
+    inline size_t netpbm_file_size(char type, uint32_t width, uint32_t height){
+        char header[64];
+        int length = (type == '4') ? snprintf(header, sizeof(header), "P4\n%u %u\n", width, height) : snprintf(header, sizeof(header), "P%c\n%u %u\n255\n", type, width, height);
+        return length + netpbm_row_size(type, width, 255) * height;
+    }
+
+    //reads the pixel data of a binary Netpbm file into dst (rows top down, without padding)
+    //PBM rows are copied as they are (1 bit per pixel), samples of PGM and PPM files are scaled to 8 bits
+    //files with a max value of 255 (the usual case) and PBM files are read in one go
+    inline bool read_netpbm_data(source &in, const netpbm_info &info, uint8_t *dst){
+        if(!netpbm_data_fits(in, info))
+            return false;
+        size_t row_size = info.pixel_data_size / info.height;
+
+        if(info.type == '4' || info.max_value == 255)
+            return in.read_at(info.pixel_data_offset, dst, info.pixel_data_size);
+
+        size_t samples = row_size / (info.max_value > 255 ? 2 : 1);
+        if(info.max_value < 255){
+            //8 bit samples with a smaller range, read everything and stretch it with a lookup table
+            if(!in.read_at(info.pixel_data_offset, dst, info.pixel_data_size))
+                return false;
+            uint8_t scale[256];
+            for(uint32_t i = 0; i < 256; i++){
+                scale[i] = (std::min(i, info.max_value) * 255 + info.max_value / 2) / info.max_value;
+            }
+            for(size_t i = 0; i < samples * info.height; i++){
+                dst[i] = scale[dst[i]];
+            }
+            return true;
+        }
+
+        //16 bit samples (big endian), converted row by row
+        std::vector<uint8_t> row(row_size);
+        for(uint32_t y = 0; y < info.height; y++){
+            if(!in.read_at(info.pixel_data_offset + (uint64_t)y * row_size, row.data(), row_size))
+                return false;
+            uint8_t *out = dst + (size_t)y * samples;
+            for(size_t i = 0; i < samples; i++){
+                uint32_t val = std::min((uint32_t)(row[i * 2] << 8 | row[i * 2 + 1]), info.max_value);
+                out[i] = (val * 255 + info.max_value / 2) / info.max_value;
+            }
+        }
+        return true;
+    }
+}
\ No newline at end of file
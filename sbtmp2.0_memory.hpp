@@ -0,0 +1,386 @@
+/*
+ *  Pixel memory for Simple Bitmap 2.0
+ *
+ *  All format classes get their pixel buffers from here instead of calling calloc/free directly.
+ *
+ *  Small buffers come from the heap, aligned to a cache line (pixel_alignment). Large ones (large canvas mode, see huge_page_threshold)
+ *  are mapped directly from the OS and aligned to the huge page size, so the OS can back them with
+ *  transparent huge pages. A full pass over a large image then needs a fraction of the TLB entries.
+ *  Define sbtmp_explicit_huge_pages to request explicit huge pages (MAP_HUGETLB) first, these have to
+ *  be reserved by the administrator, if none are available the transparent ones are used.
+ *
+ *  Define sbtmp_huge_page_threshold to change the size at which large canvas mode kicks in.
+ *
+ *  The format classes don't call these functions directly but go through an allocator. By default that is
+ *  the heap allocator (alloc_pixels/free_pixels), set_default_allocator or set_allocator of an image replace it.
+ *  A buffer_pool keeps the buffers of deleted images and hands them out again to the next image of the
+ *  same size, so code that creates and deletes lots of images doesn't pay for malloc and page faults every time.
+ */
+
+
+#pragma once
+
+#include "sbtmp2.0_base.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define sbtmp_has_mmap
+#endif
+#ifdef _WIN32
+    #include <malloc.h>
+#endif
+
+
+namespace sbtmp::memory {
+
+    //buffers of at least this size are allocated in large canvas mode
+    #ifdef sbtmp_huge_page_threshold
+    constexpr size_t huge_page_threshold = sbtmp_huge_page_threshold;
+    #else
+    constexpr size_t huge_page_threshold = 4 << 20;
+    #endif
+
+    //size of a (x86/ARM) huge page
+    constexpr size_t huge_page_size = 2 << 20;
+
+    //every pixel buffer starts at a multiple of this (a cache line, also enough for AVX-512 loads)
+    //together with a row alignment of 64 every row of an image starts at such an address
+    constexpr size_t pixel_alignment = 64;
+
+    //returns true if a buffer of this size is mapped instead of allocated from the heap
+    constexpr bool is_large(size_t size){
+    #ifdef sbtmp_has_mmap
+        return size >= huge_page_threshold;
+    #else
+        (void)size;
+        return false;
+    #endif
+    }
+
+    //size of the mapping behind a large buffer
+    constexpr size_t large_size(size_t size){
+        return (size + huge_page_size - 1) & ~(huge_page_size - 1);
+    }
+
+    //allocates size bytes (a multiple of alignment) at a multiple of alignment from the heap, free them with free_aligned
+    //MSVC has no aligned_alloc, it has _aligned_malloc instead (and these blocks can't go to free)
+    inline uint8_t *alloc_aligned(size_t size, size_t alignment){
+    #ifdef _WIN32
+        return (uint8_t*)_aligned_malloc(size, alignment);
+    #else
+        return (uint8_t*)std::aligned_alloc(alignment, size);
+    #endif
+    }
+
+    inline void free_aligned(uint8_t *ptr){
+    #ifdef _WIN32
+        _aligned_free(ptr);
+    #else
+        free(ptr);
+    #endif
+    }
+
+    //allocates a zero initialized pixel buffer
+    inline uint8_t *alloc_pixels(size_t size){
+    #ifdef sbtmp_has_mmap
+        if(is_large(size)){
+            size_t length = large_size(size);
+
+        #if defined(sbtmp_explicit_huge_pages) && defined(MAP_HUGETLB)
+            void *huge = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if(huge != MAP_FAILED)
+                return (uint8_t*)huge;
+        #endif
+
+            //map one huge page more than needed and cut off the ends, so the buffer starts at a huge page boundary
+            void *addr = mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(addr == MAP_FAILED)
+                return nullptr;
+            uintptr_t start = ((uintptr_t)addr + huge_page_size - 1) & ~(uintptr_t)(huge_page_size - 1);
+            size_t head = start - (uintptr_t)addr;
+            if(head)
+                munmap(addr, head);
+            if(huge_page_size - head)
+                munmap((uint8_t*)start + length, huge_page_size - head);
+
+        #ifdef MADV_HUGEPAGE
+            madvise((void*)start, length, MADV_HUGEPAGE);
+        #endif
+            //fresh anonymous memory is already zeroed
+            return (uint8_t*)start;
+        }
+    #endif
+        //aligned_alloc wants a multiple of the alignment
+        size_t length = std::max((size + pixel_alignment - 1) & ~(pixel_alignment - 1), pixel_alignment);
+        uint8_t *ptr = alloc_aligned(length, pixel_alignment);
+        if(ptr)
+            memset(ptr, 0, length);
+        return ptr;
+    }
+
+    //frees a buffer from alloc_pixels, size has to be the size it was allocated with
+    inline void free_pixels(uint8_t *ptr, size_t size){
+        if(!ptr)
+            return;
+    #ifdef sbtmp_has_mmap
+        if(is_large(size)){
+            munmap(ptr, large_size(size));
+            return;
+        }
+    #endif
+        free_aligned(ptr);
+    }
+
+    //changes the size of a buffer from alloc_pixels (the content is kept up to the smaller size)
+    //returns nullptr and leaves the old buffer alone if there is not enough memory
+    inline uint8_t *realloc_pixels(uint8_t *ptr, size_t old_size, size_t new_size){
+        if(!ptr)
+            return alloc_pixels(new_size);
+
+        //the mapping (or aligned heap block) is already large enough
+        if(is_large(old_size) && is_large(new_size) && large_size(old_size) == large_size(new_size))
+            return ptr;
+        if(!is_large(old_size) && !is_large(new_size) && (old_size + pixel_alignment - 1) / pixel_alignment == (new_size + pixel_alignment - 1) / pixel_alignment)
+            return ptr;
+
+        //realloc doesn't keep the alignment, so the data is copied into a new buffer
+
+        uint8_t *new_ptr = alloc_pixels(new_size);
+        if(!new_ptr)
+            return nullptr;
+        memcpy(new_ptr, ptr, std::min(old_size, new_size));
+        free_pixels(ptr, old_size);
+        return new_ptr;
+    }
+
+    //interface for everything that hands out pixel buffers
+    //derive from it to give images their memory from somewhere else
+    class allocator{
+        public:
+        virtual ~allocator() = default;
+
+        //returns a zero initialized buffer of at least size bytes (aligned to pixel_alignment) or nullptr
+        virtual uint8_t *allocate(size_t size) = 0;
+
+        //takes back a buffer from allocate, size has to be the size it was allocated with
+        virtual void deallocate(uint8_t *ptr, size_t size) = 0;
+
+        //changes the size of a buffer from allocate (the content is kept up to the smaller size)
+        //returns nullptr and leaves the old buffer alone if there is not enough memory
+        virtual uint8_t *reallocate(uint8_t *ptr, size_t old_size, size_t new_size){
+            if(!ptr)
+                return allocate(new_size);
+            uint8_t *new_ptr = allocate(new_size);
+            if(!new_ptr)
+                return nullptr;
+            memcpy(new_ptr, ptr, std::min(old_size, new_size));
+            deallocate(ptr, old_size);
+            return new_ptr;
+        }
+    };
+
+    //allocator using alloc_pixels/free_pixels, every image uses it unless it is told otherwise
+    class heap_allocator final : public allocator{
+        public:
+        uint8_t *allocate(size_t size) override {
+            return alloc_pixels(size);
+        }
+
+        void deallocate(uint8_t *ptr, size_t size) override {
+            free_pixels(ptr, size);
+        }
+
+        uint8_t *reallocate(uint8_t *ptr, size_t old_size, size_t new_size) override {
+            return realloc_pixels(ptr, old_size, new_size);
+        }
+    };
+
+    inline heap_allocator &heap(){
+        static heap_allocator instance;
+        return instance;
+    }
+
+    inline allocator *default_allocator = nullptr;
+
+    //returns the allocator new images use
+    inline allocator &get_default_allocator(){
+        return default_allocator ? *default_allocator : heap();
+    }
+
+    //changes the allocator new images use (nullptr switches back to the heap)
+    //images keep the allocator they got their first buffer from, so this only affects images created afterwards
+    //the allocator has to live longer than every image using it
+    inline void set_default_allocator(allocator *alloc){
+        default_allocator = alloc;
+    }
+
+    //reference count of a pixel buffer shared by several images (copy on write)
+    //the images share the buffer until one of them changes it, the last one using it frees it
+    struct shared_buffer{
+        explicit shared_buffer(allocator *owner) : owner(owner) {}
+
+        void add_ref(){
+            refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //returns true if the caller was the last user and has to free the buffer
+        bool release(){
+            return refs.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        bool is_unique(){
+            return refs.load(std::memory_order_acquire) == 1;
+        }
+
+        allocator *owner; //the allocator the buffer came from
+        std::atomic<uint32_t> refs{1};
+    };
+
+    //statistics of a buffer_pool
+    struct pool_stats{
+        uint64_t hits = 0; //allocations served with a buffer from the pool
+        uint64_t misses = 0; //allocations that needed new memory
+        uint64_t returns = 0; //buffers given back and kept for reuse
+        uint64_t discards = 0; //buffers given back and freed because the pool was full
+        size_t cached_buffers = 0; //buffers waiting in the pool right now
+        size_t cached_bytes = 0; //memory used by these buffers
+    };
+
+    //allocator that keeps freed buffers and reuses them for the next allocation of the same size
+    //buffers are sorted into buckets by their real size (rounded up to pixel_alignment, or to the huge page size
+    //for large buffers), so all images with the same dimensions and type share one bucket
+    //reused buffers are cleared before they are handed out, like new ones
+    //
+    //the pool can be shared between threads
+    //IMPORTANT: the pool has to live longer than every image using it!
+    class buffer_pool final : public allocator{
+        public:
+
+        //max_cached_bytes: once the pool holds this much memory, returned buffers are freed instead of kept
+        //upstream: where the pool gets new buffers from and frees them to
+        explicit buffer_pool(size_t max_cached_bytes = 256 << 20, allocator &upstream = heap()) : upstream(upstream), max_cached(max_cached_bytes) {}
+
+        buffer_pool(const buffer_pool &) = delete;
+        buffer_pool &operator=(const buffer_pool &) = delete;
+
+        ~buffer_pool(){
+            release();
+        }
+
+        uint8_t *allocate(size_t size) override {
+            size_t bucket = bucket_size(size);
+            uint8_t *ptr = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                auto it = buckets.find(bucket);
+                if(it != buckets.end() && !it->second.empty()){
+                    ptr = it->second.back();
+                    it->second.pop_back();
+                    stats.hits++;
+                    stats.cached_buffers--;
+                    stats.cached_bytes -= bucket;
+                }
+                else
+                    stats.misses++;
+            }
+            if(!ptr)
+                return upstream.allocate(bucket);
+            //the buffer is hot in the cache and already backed by memory, clearing it is cheap
+            //it is cleared after the lock is released, so other threads don't wait for it
+            memset(ptr, 0, size);
+            return ptr;
+        }
+
+        void deallocate(uint8_t *ptr, size_t size) override {
+            if(!ptr)
+                return;
+            size_t bucket = bucket_size(size);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if(stats.cached_bytes + bucket <= max_cached){
+                    buckets[bucket].push_back(ptr);
+                    stats.returns++;
+                    stats.cached_buffers++;
+                    stats.cached_bytes += bucket;
+                    return;
+                }
+                stats.discards++;
+            }
+            upstream.deallocate(ptr, bucket);
+        }
+
+        uint8_t *reallocate(uint8_t *ptr, size_t old_size, size_t new_size) override {
+            //the buffer is already large enough
+            if(ptr && bucket_size(old_size) == bucket_size(new_size))
+                return ptr;
+            return allocator::reallocate(ptr, old_size, new_size);
+        }
+
+        //returns the statistics of the pool
+        pool_stats get_stats(){
+            std::lock_guard<std::mutex> lock(mtx);
+            return stats;
+        }
+
+        //sets the hit/miss/return/discard counters back to 0
+        void reset_stats(){
+            std::lock_guard<std::mutex> lock(mtx);
+            stats.hits = 0;
+            stats.misses = 0;
+            stats.returns = 0;
+            stats.discards = 0;
+        }
+
+        //changes how much memory the pool may hold, buffers above the new limit are freed
+        void set_max_cached_bytes(size_t max_cached_bytes){
+            std::lock_guard<std::mutex> lock(mtx);
+            max_cached = max_cached_bytes;
+            for(auto &[bucket, buffers] : buckets){
+                while(!buffers.empty() && stats.cached_bytes > max_cached){
+                    upstream.deallocate(buffers.back(), bucket);
+                    buffers.pop_back();
+                    stats.cached_buffers--;
+                    stats.cached_bytes -= bucket;
+                }
+            }
+        }
+
+        //frees all buffers waiting in the pool (buffers used by images are not affected)
+        void release(){
+            std::lock_guard<std::mutex> lock(mtx);
+            for(auto &[bucket, buffers] : buckets){
+                for(uint8_t *ptr : buffers)
+                    upstream.deallocate(ptr, bucket);
+            }
+            buckets.clear();
+            stats.cached_buffers = 0;
+            stats.cached_bytes = 0;
+        }
+
+
+        private:
+
+        //real size of a buffer, all requests with the same bucket size can use the same buffer
+        static size_t bucket_size(size_t size){
+            if(is_large(size))
+                return large_size(size);
+            return std::max((size + pixel_alignment - 1) & ~(pixel_alignment - 1), pixel_alignment);
+        }
+
+        allocator &upstream;
+        std::mutex mtx;
+        std::unordered_map<size_t, std::vector<uint8_t*>> buckets;
+        size_t max_cached;
+        pool_stats stats;
+    };
+}
\ No newline at end of file
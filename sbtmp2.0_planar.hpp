@@ -0,0 +1,432 @@
+#pragma once
+
+#include "sbtmp2.0_io.hpp"
+#include "sbtmp2.0_simd.hpp"
+
+namespace sbtmp::formats{
+    //image with one plane per channel (all reds, then all greens, then all blues, then all alphas)
+    //filters that work on one channel at a time (blur, lookup tables, histograms...) can walk a plane like a gray image
+    //and process a whole vector of pixels at once, without picking the channel out of interleaved pixels first
+    //
+    //every row of a plane starts at a multiple of 64 bytes (see get_plane_stride), the padding is never touched
+    //images without alpha (with_alpha = false) only have 3 planes and return an alpha of 255
+    //
+    //planar images have no file format, convert them with from_image/to_image to save or load them
+    //(the conversion from and to Bitmap24, Bitmap32, PPM and PGM uses SIMD kernels, see sbtmp2.0_simd.hpp)
+    class Planar final : public sbtmp::base::image{
+        public:
+
+        //plane numbers
+        enum channel : uint8_t{
+            red = 0,
+            green = 1,
+            blue = 2,
+            alpha = 3
+        };
+
+        //constructor
+        Planar(uint32_t set_width, uint32_t set_height, bool with_alpha = true) {
+            plane_count = with_alpha ? 4 : 3;
+            create(set_width, set_height);
+        }
+
+        //copy constructor
+        //creates a perfect copy of the original image
+        Planar(const Planar &other){
+            copy_from(other);
+        }
+
+        //move constructor, takes over the pixel data of the other image and leaves it empty
+        Planar(Planar &&other) noexcept{
+            move_from(other);
+        }
+
+        Planar &operator=(const Planar &other){
+            if(this != &other){
+                del();
+                copy_from(other);
+            }
+            return *this;
+        }
+
+        Planar &operator=(Planar &&other) noexcept{
+            if(this != &other){
+                del();
+                move_from(other);
+            }
+            return *this;
+        }
+
+        Planar() = default;
+
+        ~Planar(){
+            del();
+        }
+
+        //create function (recommended way to init images)
+        void create(uint32_t set_width, uint32_t set_height) override {
+            if(initialized)
+                return;
+
+            size_t stride = stride_for(set_width);
+            pixel_data = get_allocator().allocate(stride * set_height * plane_count);
+            if(!pixel_data)
+                return;
+
+            btmp_width = set_width;
+            btmp_height = set_height;
+            plane_stride = stride;
+            raw_data_size = plane_stride * btmp_height * plane_count;
+
+            initialized = true;
+        }
+
+        //copies the pixels of another image into this one
+        //an empty planar image gets the size of src, otherwise both images have to have the same size
+        //images that tell how their pixels are stored (see base::image::get_row) are converted row by row with SIMD kernels,
+        //all others pixel by pixel
+        bool from_image(base::image &src){
+            if(!src.is_initialized())
+                return false;
+            if(!initialized)
+                create(src.get_width(), src.get_height());
+            if(!initialized || src.get_width() != btmp_width || src.get_height() != btmp_height)
+                return false;
+
+            base::channel_order order = src.get_channel_order();
+            if(!has_row_access(src, order)){
+                for(uint32_t y = 0; y < btmp_height; y++){
+                    for(uint32_t x = 0; x < btmp_width; x++){
+                        set_pixel_unchecked(x, y, src.get_pixel(x, y));
+                    }
+                }
+                return true;
+            }
+
+            //bytes that have no plane of their own (alpha of a 3 plane image) are split into this row
+            std::vector<uint8_t> unused_row(order == base::channel_order::bgra || order == base::channel_order::rgba ? btmp_width : 0);
+            for(uint32_t y = 0; y < btmp_height; y++){
+                const uint8_t *row = src.get_const_row(y);
+                uint8_t *r = get_plane_row(red, y), *g = get_plane_row(green, y), *b = get_plane_row(blue, y);
+                uint8_t *a = plane_count == 4 ? get_plane_row(alpha, y) : unused_row.data();
+                switch(order){
+                    case base::channel_order::bgra:
+                        simd::deinterleave4(row, b, g, r, a, btmp_width);
+                        break;
+                    case base::channel_order::rgba:
+                        simd::deinterleave4(row, r, g, b, a, btmp_width);
+                        break;
+                    case base::channel_order::bgr:
+                        simd::deinterleave3(row, b, g, r, btmp_width);
+                        break;
+                    case base::channel_order::rgb:
+                        simd::deinterleave3(row, r, g, b, btmp_width);
+                        break;
+                    default: //gray
+                        memcpy(r, row, btmp_width);
+                        memcpy(g, row, btmp_width);
+                        memcpy(b, row, btmp_width);
+                        break;
+                }
+                //images without alpha are opaque
+                if(plane_count == 4 && order != base::channel_order::bgra && order != base::channel_order::rgba)
+                    memset(a, 255, btmp_width);
+            }
+            return true;
+        }
+
+        //copies the pixels of this image into another one
+        //an empty dst is created with the size of this image, otherwise both images have to have the same size
+        //converted the same way as from_image
+        bool to_image(base::image &dst){
+            if(!initialized)
+                return false;
+            if(!dst.is_initialized())
+                dst.create(btmp_width, btmp_height);
+            if(!dst.is_initialized() || dst.get_width() != btmp_width || dst.get_height() != btmp_height)
+                return false;
+
+            base::channel_order order = dst.get_channel_order();
+            if(!has_row_access(dst, order)){
+                for(uint32_t y = 0; y < btmp_height; y++){
+                    for(uint32_t x = 0; x < btmp_width; x++){
+                        dst.set_pixel(x, y, get_pixel_unchecked(x, y));
+                    }
+                }
+                return true;
+            }
+
+            //3 plane images are written with an opaque alpha channel
+            std::vector<uint8_t> opaque_row(plane_count == 3 && (order == base::channel_order::bgra || order == base::channel_order::rgba) ? btmp_width : 0, 255);
+            for(uint32_t y = 0; y < btmp_height; y++){
+                uint8_t *row = dst.get_row(y);
+                const uint8_t *r = get_plane_row(red, y), *g = get_plane_row(green, y), *b = get_plane_row(blue, y);
+                const uint8_t *a = plane_count == 4 ? get_plane_row(alpha, y) : opaque_row.data();
+                switch(order){
+                    case base::channel_order::bgra:
+                        simd::interleave4(b, g, r, a, row, btmp_width);
+                        break;
+                    case base::channel_order::rgba:
+                        simd::interleave4(r, g, b, a, row, btmp_width);
+                        break;
+                    case base::channel_order::bgr:
+                        simd::interleave3(b, g, r, row, btmp_width);
+                        break;
+                    case base::channel_order::rgb:
+                        simd::interleave3(r, g, b, row, btmp_width);
+                        break;
+                    default: //gray, same conversion as color::blackNwhite
+                        for(uint32_t x = 0; x < btmp_width; x++){
+                            row[x] = (r[x] + g[x] + b[x]) / 3;
+                        }
+                        break;
+                }
+            }
+            return true;
+        }
+
+        //set pixel at coords x, y to rgb value
+        void set_pixel(int32_t x, int32_t y, color::Color col) override {
+            if (!initialized || x > btmp_width - 1 || y > btmp_height - 1 || x < 0 || y < 0)
+                return;
+            set_pixel_unchecked(x, y, col);
+        }
+
+        //get color of pixel at coords x, y
+        color::Color get_pixel(int32_t x, int32_t y) override {
+            return get_pixel_unchecked(x, y);
+        }
+
+        //same as set_pixel and get_pixel, but without checking if the image is initialized and the pixel is inside of it
+        //the graphics and filters templates use these for pixels they already know to be inside the image
+        void set_pixel_unchecked(int32_t x, int32_t y, color::Color col){
+            size_t index = get_p_index(x, y);
+            size_t plane_size = plane_stride * btmp_height;
+            pixel_data[index] = color::get_red(col);
+            pixel_data[index + plane_size] = color::get_green(col);
+            pixel_data[index + plane_size * 2] = color::get_blue(col);
+            if(plane_count == 4)
+                pixel_data[index + plane_size * 3] = color::get_alpha(col);
+        }
+        color::Color get_pixel_unchecked(int32_t x, int32_t y){
+            size_t index = get_p_index(x, y);
+            size_t plane_size = plane_stride * btmp_height;
+            return color::set_col(pixel_data[index], pixel_data[index + plane_size], pixel_data[index + plane_size * 2], plane_count == 4 ? pixel_data[index + plane_size * 3] : 255);
+        }
+
+        //returns the first row of a plane (red, green, blue or alpha), nullptr if the image has no such plane
+        uint8_t *get_plane(uint8_t channel){
+            return get_plane_row(channel, 0);
+        }
+
+        //returns row y of a plane (y = 0 is the top row), nullptr if there is no such row
+        uint8_t *get_plane_row(uint8_t channel, uint32_t y){
+            if(!initialized || channel >= plane_count || y >= btmp_height)
+                return nullptr;
+            return pixel_data + (channel * (size_t)btmp_height + y) * plane_stride;
+        }
+
+        //returns the distance between two rows of a plane in bytes (a multiple of 64)
+        size_t get_plane_stride(){
+            return plane_stride;
+        }
+
+        //returns 4 for images with alpha, 3 for images without
+        uint8_t get_plane_count(){
+            return plane_count;
+        }
+
+        bool has_alpha(){
+            return plane_count == 4;
+        }
+
+        //sets count pixels of row y, starting at x, to one color (pixels outside the image are skipped)
+        void fill_span(int32_t x, int32_t y, uint32_t count, color::Color col) override {
+            int64_t first = std::max<int64_t>(x, 0), last = std::min<int64_t>((int64_t)x + count, btmp_width);
+            if(!initialized || y < 0 || y >= btmp_height || first >= last)
+                return;
+            fill_span_unchecked(first, y, last - first, col);
+        }
+
+        //same as fill_span, but without any checks (see base::fill_span), every plane gets one memset
+        void fill_span_unchecked(int32_t x, int32_t y, uint32_t count, color::Color col){
+            uint8_t value[4] = {color::get_red(col), color::get_green(col), color::get_blue(col), color::get_alpha(col)};
+            for(uint8_t c = 0; c < plane_count; c++){
+                memset(get_plane_row(c, y) + x, value[c], count);
+            }
+        }
+
+        //return width of the image
+        uint32_t get_width() override {
+            return btmp_width;
+        }
+
+        //returns height of the image
+        uint32_t get_height() override {
+            return btmp_height;
+        }
+
+        //returns size of the raw data array in bytes
+        size_t get_raw_size() override {
+            return raw_data_size;
+        }
+
+        //changes the size of the image
+        //unlike the interleaved image types the picture is kept (cut off or extended with black pixels),
+        //every plane would end up somewhere else otherwise
+        void resize(uint32_t width, uint32_t height) override {
+            if(!initialized)
+                return;
+            if(width == btmp_width && height == btmp_height) // args are the same size as image
+                return;
+
+            size_t stride = stride_for(width);
+            size_t size = stride * height * plane_count;
+            uint8_t *data = get_allocator().allocate(size);
+            if(!data) // not enough memory, keep the old image
+                return;
+
+            size_t row_size = std::min(width, btmp_width);
+            for(uint8_t c = 0; c < plane_count; c++){
+                for(uint32_t y = 0; y < std::min(height, btmp_height); y++){
+                    memcpy(data + (c * (size_t)height + y) * stride, get_plane_row(c, y), row_size);
+                }
+            }
+            get_allocator().deallocate(pixel_data, raw_data_size);
+
+            pixel_data = data;
+            btmp_width = width;
+            btmp_height = height;
+            plane_stride = stride;
+            raw_data_size = size;
+        }
+
+        //clears the image
+        void clear() override {
+            if(!initialized)
+                return;
+            memset(pixel_data, 0, raw_data_size);
+        }
+
+        //frees the memory of the image and resets all properties
+        //the number of planes stays the same
+        void del() override {
+            if(!initialized)
+                return;
+
+            get_allocator().deallocate(pixel_data, raw_data_size);
+            pixel_data = nullptr;
+
+            btmp_width = 0;
+            btmp_height = 0;
+            plane_stride = 0;
+            raw_data_size = 0;
+
+            initialized = false;
+        }
+
+        //changes where the image gets its pixel memory from (a memory::buffer_pool for example)
+        //only possible while the image is empty, returns false otherwise
+        //the allocator has to live longer than the image
+        bool set_allocator(memory::allocator &alloc){
+            if(initialized)
+                return false;
+            pixel_allocator = &alloc;
+            return true;
+        }
+
+        //returns the allocator of the image (the default allocator if none was set)
+        memory::allocator &get_allocator(){
+            if(!pixel_allocator)
+                pixel_allocator = &memory::get_default_allocator();
+            return *pixel_allocator;
+        }
+
+        bool is_initialized() override {
+            return initialized;
+        }
+
+        //returns the pixel data (all planes one after another, see get_plane_row)
+        uint8_t *data() override {
+            return pixel_data;
+        }
+
+
+        private:
+
+        //true if the pixels of img can be converted row by row
+        static bool has_row_access(base::image &img, base::channel_order order){
+            switch(order){
+                case base::channel_order::bgra:
+                case base::channel_order::rgba:
+                    return img.get_bytes_per_pixel() == 4 && img.get_const_row(0);
+                case base::channel_order::bgr:
+                case base::channel_order::rgb:
+                    return img.get_bytes_per_pixel() == 3 && img.get_const_row(0);
+                case base::channel_order::gray:
+                    return img.get_bytes_per_pixel() == 1 && img.get_const_row(0);
+                default:
+                    return false;
+            }
+        }
+
+        //returns the index of a pixel in the red plane
+        size_t get_p_index(uint32_t x_pos, uint32_t y_pos){
+            return (size_t)y_pos * plane_stride + x_pos;
+        }
+
+        //distance between two rows of a plane of an image with this width
+        static size_t stride_for(uint32_t width){
+            return ((size_t)width + memory::pixel_alignment - 1) & ~(memory::pixel_alignment - 1);
+        }
+
+        //used by the copy constructor and copy assignment, expects this image to be empty
+        void copy_from(const Planar &other){
+            plane_count = other.plane_count;
+            if(!other.initialized)
+                return;
+            //a copy uses the same allocator as the original, unless it already has one
+            if(!pixel_allocator)
+                pixel_allocator = other.pixel_allocator;
+            pixel_data = get_allocator().allocate(other.raw_data_size);
+            if(!pixel_data)
+                return;
+            memcpy(pixel_data, other.pixel_data, other.raw_data_size);
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            plane_stride = other.plane_stride;
+            raw_data_size = other.raw_data_size;
+            initialized = true;
+        }
+
+        //used by the move constructor and move assignment, expects this image to be empty
+        void move_from(Planar &other){
+            plane_count = other.plane_count;
+            if(!other.initialized)
+                return;
+            pixel_data = other.pixel_data;
+            pixel_allocator = other.pixel_allocator; //the pixel data has to go back to where it came from
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            plane_stride = other.plane_stride;
+            raw_data_size = other.raw_data_size;
+            initialized = true;
+
+            other.pixel_data = nullptr;
+            other.btmp_width = 0;
+            other.btmp_height = 0;
+            other.plane_stride = 0;
+            other.raw_data_size = 0;
+            other.initialized = false;
+        }
+
+        uint32_t btmp_width = 0, btmp_height = 0;
+        size_t plane_stride = 0; //distance between two rows of a plane
+        size_t raw_data_size = 0;
+        uint8_t plane_count = 4;
+
+        uint8_t * pixel_data = nullptr;
+        memory::allocator *pixel_allocator = nullptr; //where pixel_data comes from, see get_allocator
+        bool initialized = false;
+    };
+}
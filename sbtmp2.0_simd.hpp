@@ -0,0 +1,593 @@
+/*
+ *  SIMD kernels for Simple Bitmap 2.0
+ *
+ *  Small loops over rows of pixels that are used by several image types. Every kernel has a plain C++ version,
+ *  the SSE versions are only compiled in if the compiler is allowed to use them (-mssse3, -march=native...).
+ *  Define sbtmp_no_simd to always use the plain versions.
+ *
+ *  The kernels don't care about alignment, rows of images with a row alignment of 64 are just a bit faster.
+ *  The fill kernels use AVX2 if it is available (-mavx2) and SSE2 otherwise (always there on x86-64).
+ *
+ *  This file doesn't depend on the rest of the library, the base file includes it for the filters.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if !defined(sbtmp_no_simd) && (defined(__SSE2__) || defined(_M_X64))
+    #include <emmintrin.h>
+    #define sbtmp_has_sse2
+#endif
+#if !defined(sbtmp_no_simd) && defined(__SSSE3__)
+    #include <tmmintrin.h>
+    #define sbtmp_has_ssse3
+#endif
+#if !defined(sbtmp_no_simd) && defined(__AVX2__)
+    #include <immintrin.h>
+    #define sbtmp_has_avx2
+#endif
+
+
+namespace sbtmp::simd {
+
+    //splits count pixels of 4 bytes into 4 planes, byte n of every pixel goes to cn
+    inline void deinterleave4(const uint8_t *src, uint8_t *c0, uint8_t *c1, uint8_t *c2, uint8_t *c3, size_t count){
+        size_t i = 0;
+    #ifdef sbtmp_has_ssse3
+        //sort the bytes of 4 pixels by channel, then transpose the 4x4 block of 32 bit groups
+        const __m128i by_channel = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+        for(; i + 16 <= count; i += 16){
+            __m128i t0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i * 4)), by_channel);
+            __m128i t1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i * 4 + 16)), by_channel);
+            __m128i t2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i * 4 + 32)), by_channel);
+            __m128i t3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i * 4 + 48)), by_channel);
+            __m128i lo01 = _mm_unpacklo_epi32(t0, t1), lo23 = _mm_unpacklo_epi32(t2, t3);
+            __m128i hi01 = _mm_unpackhi_epi32(t0, t1), hi23 = _mm_unpackhi_epi32(t2, t3);
+            _mm_storeu_si128((__m128i*)(c0 + i), _mm_unpacklo_epi64(lo01, lo23));
+            _mm_storeu_si128((__m128i*)(c1 + i), _mm_unpackhi_epi64(lo01, lo23));
+            _mm_storeu_si128((__m128i*)(c2 + i), _mm_unpacklo_epi64(hi01, hi23));
+            _mm_storeu_si128((__m128i*)(c3 + i), _mm_unpackhi_epi64(hi01, hi23));
+        }
+    #endif
+        for(; i < count; i++){
+            c0[i] = src[i * 4 + 0];
+            c1[i] = src[i * 4 + 1];
+            c2[i] = src[i * 4 + 2];
+            c3[i] = src[i * 4 + 3];
+        }
+    }
+
+#ifdef sbtmp_has_ssse3
+    //splits 16 pixels of 3 bytes (the vectors a, b and c) into byte 0, 1 and 2 of every pixel
+    inline void split3(__m128i a, __m128i b, __m128i c, __m128i &c0, __m128i &c1, __m128i &c2){
+        //every plane gets its bytes from all 3 vectors (-1 = zero)
+        const __m128i c0_a = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i c0_b = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+        const __m128i c0_c = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+        const __m128i c1_a = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i c1_b = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+        const __m128i c1_c = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+        const __m128i c2_a = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i c2_b = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+        const __m128i c2_c = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+        c0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, c0_a), _mm_shuffle_epi8(b, c0_b)), _mm_shuffle_epi8(c, c0_c));
+        c1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, c1_a), _mm_shuffle_epi8(b, c1_b)), _mm_shuffle_epi8(c, c1_c));
+        c2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, c2_a), _mm_shuffle_epi8(b, c2_b)), _mm_shuffle_epi8(c, c2_c));
+    }
+#endif
+
+    //splits count pixels of 3 bytes into 3 planes, byte n of every pixel goes to cn
+    inline void deinterleave3(const uint8_t *src, uint8_t *c0, uint8_t *c1, uint8_t *c2, size_t count){
+        size_t i = 0;
+    #ifdef sbtmp_has_ssse3
+        for(; i + 16 <= count; i += 16){
+            __m128i v0, v1, v2;
+            split3(_mm_loadu_si128((const __m128i*)(src + i * 3)), _mm_loadu_si128((const __m128i*)(src + i * 3 + 16)), _mm_loadu_si128((const __m128i*)(src + i * 3 + 32)), v0, v1, v2);
+            _mm_storeu_si128((__m128i*)(c0 + i), v0);
+            _mm_storeu_si128((__m128i*)(c1 + i), v1);
+            _mm_storeu_si128((__m128i*)(c2 + i), v2);
+        }
+    #endif
+        for(; i < count; i++){
+            c0[i] = src[i * 3 + 0];
+            c1[i] = src[i * 3 + 1];
+            c2[i] = src[i * 3 + 2];
+        }
+    }
+
+    //joins 4 planes into count pixels of 4 bytes, cn becomes byte n of every pixel
+    inline void interleave4(const uint8_t *c0, const uint8_t *c1, const uint8_t *c2, const uint8_t *c3, uint8_t *dst, size_t count){
+        size_t i = 0;
+    #ifdef sbtmp_has_sse2
+        for(; i + 16 <= count; i += 16){
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(c0 + i));
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(c1 + i));
+            __m128i v2 = _mm_loadu_si128((const __m128i*)(c2 + i));
+            __m128i v3 = _mm_loadu_si128((const __m128i*)(c3 + i));
+            //byte pairs c0 c1 and c2 c3, then pairs of pairs
+            __m128i lo01 = _mm_unpacklo_epi8(v0, v1), lo23 = _mm_unpacklo_epi8(v2, v3);
+            __m128i hi01 = _mm_unpackhi_epi8(v0, v1), hi23 = _mm_unpackhi_epi8(v2, v3);
+            _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_unpacklo_epi16(lo01, lo23));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_unpackhi_epi16(lo01, lo23));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 32), _mm_unpacklo_epi16(hi01, hi23));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 48), _mm_unpackhi_epi16(hi01, hi23));
+        }
+    #endif
+        for(; i < count; i++){
+            dst[i * 4 + 0] = c0[i];
+            dst[i * 4 + 1] = c1[i];
+            dst[i * 4 + 2] = c2[i];
+            dst[i * 4 + 3] = c3[i];
+        }
+    }
+
+    //joins 3 planes into count pixels of 3 bytes, cn becomes byte n of every pixel
+    inline void interleave3(const uint8_t *c0, const uint8_t *c1, const uint8_t *c2, uint8_t *dst, size_t count){
+        size_t i = 0;
+    #ifdef sbtmp_has_ssse3
+        //every output vector gets its bytes from all 3 planes (-1 = zero)
+        const __m128i a_c0 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+        const __m128i a_c1 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+        const __m128i a_c2 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+        const __m128i b_c0 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+        const __m128i b_c1 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+        const __m128i b_c2 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+        const __m128i c_c0 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+        const __m128i c_c1 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+        const __m128i c_c2 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+        for(; i + 16 <= count; i += 16){
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(c0 + i));
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(c1 + i));
+            __m128i v2 = _mm_loadu_si128((const __m128i*)(c2 + i));
+            _mm_storeu_si128((__m128i*)(dst + i * 3), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, a_c0), _mm_shuffle_epi8(v1, a_c1)), _mm_shuffle_epi8(v2, a_c2)));
+            _mm_storeu_si128((__m128i*)(dst + i * 3 + 16), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, b_c0), _mm_shuffle_epi8(v1, b_c1)), _mm_shuffle_epi8(v2, b_c2)));
+            _mm_storeu_si128((__m128i*)(dst + i * 3 + 32), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, c_c0), _mm_shuffle_epi8(v1, c_c1)), _mm_shuffle_epi8(v2, c_c2)));
+        }
+    #endif
+        for(; i < count; i++){
+            dst[i * 3 + 0] = c0[i];
+            dst[i * 3 + 1] = c1[i];
+            dst[i * 3 + 2] = c2[i];
+        }
+    }
+
+    //sets count pixels of 4 bytes to pixel (little endian, like in memory)
+    inline void fill32(uint8_t *dst, uint32_t pixel, size_t count){
+        size_t i = 0;
+    #if defined(sbtmp_has_avx2)
+        __m256i pattern = _mm256_set1_epi32(pixel);
+        for(; i + 32 <= count; i += 32){
+            _mm256_storeu_si256((__m256i*)(dst + i * 4), pattern);
+            _mm256_storeu_si256((__m256i*)(dst + i * 4 + 32), pattern);
+            _mm256_storeu_si256((__m256i*)(dst + i * 4 + 64), pattern);
+            _mm256_storeu_si256((__m256i*)(dst + i * 4 + 96), pattern);
+        }
+        for(; i + 8 <= count; i += 8){
+            _mm256_storeu_si256((__m256i*)(dst + i * 4), pattern);
+        }
+    #elif defined(sbtmp_has_sse2)
+        __m128i pattern = _mm_set1_epi32(pixel);
+        for(; i + 16 <= count; i += 16){
+            _mm_storeu_si128((__m128i*)(dst + i * 4), pattern);
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), pattern);
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 32), pattern);
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 48), pattern);
+        }
+        for(; i + 4 <= count; i += 4){
+            _mm_storeu_si128((__m128i*)(dst + i * 4), pattern);
+        }
+    #endif
+        for(; i < count; i++){
+            memcpy(dst + i * 4, &pixel, 4);
+        }
+    }
+
+    //sets count pixels of 3 bytes to the lower 3 bytes of pixel
+    //3 pixels don't fit into a vector evenly, so the pattern is 16 pixels long (3 SSE vectors, 48 bytes) or 32 pixels (3 AVX vectors)
+    inline void fill24(uint8_t *dst, uint32_t pixel, size_t count){
+        size_t i = 0;
+    #if defined(sbtmp_has_avx2) || defined(sbtmp_has_sse2)
+        alignas(32) uint8_t block[96];
+        for(uint32_t j = 0; j < 32; j++){
+            memcpy(block + j * 3, &pixel, 3);
+        }
+    #endif
+    #if defined(sbtmp_has_avx2)
+        __m256i p0 = _mm256_load_si256((const __m256i*)block);
+        __m256i p1 = _mm256_load_si256((const __m256i*)(block + 32));
+        __m256i p2 = _mm256_load_si256((const __m256i*)(block + 64));
+        for(; i + 32 <= count; i += 32){
+            _mm256_storeu_si256((__m256i*)(dst + i * 3), p0);
+            _mm256_storeu_si256((__m256i*)(dst + i * 3 + 32), p1);
+            _mm256_storeu_si256((__m256i*)(dst + i * 3 + 64), p2);
+        }
+    #elif defined(sbtmp_has_sse2)
+        __m128i p0 = _mm_load_si128((const __m128i*)block);
+        __m128i p1 = _mm_load_si128((const __m128i*)(block + 16));
+        __m128i p2 = _mm_load_si128((const __m128i*)(block + 32));
+        for(; i + 16 <= count; i += 16){
+            _mm_storeu_si128((__m128i*)(dst + i * 3), p0);
+            _mm_storeu_si128((__m128i*)(dst + i * 3 + 16), p1);
+            _mm_storeu_si128((__m128i*)(dst + i * 3 + 32), p2);
+        }
+    #endif
+        for(; i < count; i++){
+            memcpy(dst + i * 3, &pixel, 3);
+        }
+    }
+
+    //sets count pixels of 2 bytes to the lower 2 bytes of pixel
+    inline void fill16(uint8_t *dst, uint32_t pixel, size_t count){
+        size_t i = 0;
+    #if defined(sbtmp_has_avx2)
+        __m256i pattern = _mm256_set1_epi16((int16_t)pixel);
+        for(; i + 16 <= count; i += 16){
+            _mm256_storeu_si256((__m256i*)(dst + i * 2), pattern);
+        }
+    #elif defined(sbtmp_has_sse2)
+        __m128i pattern = _mm_set1_epi16((int16_t)pixel);
+        for(; i + 8 <= count; i += 8){
+            _mm_storeu_si128((__m128i*)(dst + i * 2), pattern);
+        }
+    #endif
+        for(; i < count; i++){
+            memcpy(dst + i * 2, &pixel, 2);
+        }
+    }
+
+    //sets count pixels of bytes_per_pixel (1 to 4) bytes to pixel
+    inline void fill(uint8_t *dst, uint32_t pixel, uint8_t bytes_per_pixel, size_t count){
+        switch(bytes_per_pixel){
+            case 4:
+                fill32(dst, pixel, count);
+                break;
+            case 3:
+                fill24(dst, pixel, count);
+                break;
+            case 2:
+                fill16(dst, pixel, count);
+                break;
+            default:
+                memset(dst, (uint8_t)pixel, count);
+                break;
+        }
+    }
+
+    //the gray kernels replace bytes 0, 1 and 2 of every pixel with a gray value, byte 3 (alpha) stays
+    //mean: (byte 0 + byte 1 + byte 2) / 3, the same as color::blackNwhite
+    //weighted: (byte 0 * w0 + byte 1 * w1 + byte 2 * w2 + 128) / 256, the weights have to add up to 256
+    //16 pixels per iteration (SSE2 for 4 byte pixels, SSSE3 for 3 byte pixels)
+
+#ifdef sbtmp_has_sse2
+    //gray values of 8 pixels, every channel in 16 bit lanes
+    inline __m128i gray_mean16(__m128i c0, __m128i c1, __m128i c2){
+        //x / 3 = (x * 0xaaab) >> 17 for every x below 2^16
+        return _mm_srli_epi16(_mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(c0, c1), c2), _mm_set1_epi16((int16_t)0xaaab)), 1);
+    }
+    inline __m128i gray_weighted16(__m128i c0, __m128i c1, __m128i c2, uint16_t w0, uint16_t w1, uint16_t w2){
+        //the sum is at most 255 * 256 + 128, so it fits into an unsigned 16 bit lane
+        __m128i sum = _mm_add_epi16(_mm_mullo_epi16(c0, _mm_set1_epi16(w0)), _mm_mullo_epi16(c1, _mm_set1_epi16(w1)));
+        sum = _mm_add_epi16(_mm_add_epi16(sum, _mm_mullo_epi16(c2, _mm_set1_epi16(w2))), _mm_set1_epi16(128));
+        return _mm_srli_epi16(sum, 8);
+    }
+
+    //gray values of 8 pixels of 4 bytes (v0 and v1) written back with the alpha of the pixels
+    template<bool Mean>
+    inline void gray8x4(uint8_t *dst, __m128i v0, __m128i v1, uint16_t w0, uint16_t w1, uint16_t w2){
+        const __m128i low = _mm_set1_epi32(0xff);
+        __m128i c0 = _mm_packs_epi32(_mm_and_si128(v0, low), _mm_and_si128(v1, low));
+        __m128i c1 = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v0, 8), low), _mm_and_si128(_mm_srli_epi32(v1, 8), low));
+        __m128i c2 = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v0, 16), low), _mm_and_si128(_mm_srli_epi32(v1, 16), low));
+        __m128i gray = Mean ? gray_mean16(c0, c1, c2) : gray_weighted16(c0, c1, c2, w0, w1, w2);
+
+        //gray -> 0x00gggggg | alpha
+        const __m128i alpha = _mm_set1_epi32((int32_t)0xff000000);
+        __m128i g0 = _mm_unpacklo_epi16(gray, _mm_setzero_si128()), g1 = _mm_unpackhi_epi16(gray, _mm_setzero_si128());
+        g0 = _mm_or_si128(_mm_or_si128(g0, _mm_slli_epi32(g0, 8)), _mm_slli_epi32(g0, 16));
+        g1 = _mm_or_si128(_mm_or_si128(g1, _mm_slli_epi32(g1, 8)), _mm_slli_epi32(g1, 16));
+        _mm_storeu_si128((__m128i*)dst, _mm_or_si128(g0, _mm_and_si128(v0, alpha)));
+        _mm_storeu_si128((__m128i*)(dst + 16), _mm_or_si128(g1, _mm_and_si128(v1, alpha)));
+    }
+#endif
+
+    template<bool Mean>
+    inline void gray4(uint8_t *row, size_t count, uint16_t w0, uint16_t w1, uint16_t w2){
+        size_t i = 0;
+    #ifdef sbtmp_has_sse2
+        for(; i + 16 <= count; i += 16){
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(row + i * 4)), v1 = _mm_loadu_si128((const __m128i*)(row + i * 4 + 16));
+            __m128i v2 = _mm_loadu_si128((const __m128i*)(row + i * 4 + 32)), v3 = _mm_loadu_si128((const __m128i*)(row + i * 4 + 48));
+            gray8x4<Mean>(row + i * 4, v0, v1, w0, w1, w2);
+            gray8x4<Mean>(row + i * 4 + 32, v2, v3, w0, w1, w2);
+        }
+    #endif
+        for(; i < count; i++){
+            uint8_t *pixel = row + i * 4;
+            uint8_t gray = Mean ? (pixel[0] + pixel[1] + pixel[2]) / 3 : (pixel[0] * w0 + pixel[1] * w1 + pixel[2] * w2 + 128) >> 8;
+            pixel[0] = pixel[1] = pixel[2] = gray;
+        }
+    }
+
+    template<bool Mean>
+    inline void gray3(uint8_t *row, size_t count, uint16_t w0, uint16_t w1, uint16_t w2){
+        size_t i = 0;
+    #ifdef sbtmp_has_ssse3
+        //byte n of the output vectors is gray value (16 * vector + n) / 3
+        const __m128i spread0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+        const __m128i spread1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+        const __m128i spread2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+        const __m128i zero = _mm_setzero_si128();
+        for(; i + 16 <= count; i += 16){
+            __m128i c0, c1, c2;
+            split3(_mm_loadu_si128((const __m128i*)(row + i * 3)), _mm_loadu_si128((const __m128i*)(row + i * 3 + 16)), _mm_loadu_si128((const __m128i*)(row + i * 3 + 32)), c0, c1, c2);
+            __m128i lo = Mean ? gray_mean16(_mm_unpacklo_epi8(c0, zero), _mm_unpacklo_epi8(c1, zero), _mm_unpacklo_epi8(c2, zero)) :
+                                gray_weighted16(_mm_unpacklo_epi8(c0, zero), _mm_unpacklo_epi8(c1, zero), _mm_unpacklo_epi8(c2, zero), w0, w1, w2);
+            __m128i hi = Mean ? gray_mean16(_mm_unpackhi_epi8(c0, zero), _mm_unpackhi_epi8(c1, zero), _mm_unpackhi_epi8(c2, zero)) :
+                                gray_weighted16(_mm_unpackhi_epi8(c0, zero), _mm_unpackhi_epi8(c1, zero), _mm_unpackhi_epi8(c2, zero), w0, w1, w2);
+            __m128i gray = _mm_packus_epi16(lo, hi);
+            _mm_storeu_si128((__m128i*)(row + i * 3), _mm_shuffle_epi8(gray, spread0));
+            _mm_storeu_si128((__m128i*)(row + i * 3 + 16), _mm_shuffle_epi8(gray, spread1));
+            _mm_storeu_si128((__m128i*)(row + i * 3 + 32), _mm_shuffle_epi8(gray, spread2));
+        }
+    #endif
+        for(; i < count; i++){
+            uint8_t *pixel = row + i * 3;
+            uint8_t gray = Mean ? (pixel[0] + pixel[1] + pixel[2]) / 3 : (pixel[0] * w0 + pixel[1] * w1 + pixel[2] * w2 + 128) >> 8;
+            pixel[0] = pixel[1] = pixel[2] = gray;
+        }
+    }
+
+    inline void gray_mean4(uint8_t *row, size_t count){
+        gray4<true>(row, count, 0, 0, 0);
+    }
+    inline void gray_mean3(uint8_t *row, size_t count){
+        gray3<true>(row, count, 0, 0, 0);
+    }
+    inline void gray_weighted4(uint8_t *row, size_t count, uint16_t w0, uint16_t w1, uint16_t w2){
+        gray4<false>(row, count, w0, w1, w2);
+    }
+    inline void gray_weighted3(uint8_t *row, size_t count, uint16_t w0, uint16_t w1, uint16_t w2){
+        gray3<false>(row, count, w0, w1, w2);
+    }
+
+    //inverts bytes 0, 1 and 2 of count pixels of 4 bytes, byte 3 (alpha) stays
+    inline void invert4(uint8_t *row, size_t count){
+        size_t i = 0;
+    #ifdef sbtmp_has_sse2
+        const __m128i mask = _mm_set1_epi32(0x00ffffff);
+        for(; i + 16 <= count; i += 16){
+            for(size_t j = 0; j < 64; j += 16){
+                __m128i *ptr = (__m128i*)(row + i * 4 + j);
+                _mm_storeu_si128(ptr, _mm_xor_si128(_mm_loadu_si128(ptr), mask));
+            }
+        }
+    #endif
+        for(; i < count; i++){
+            row[i * 4 + 0] = ~row[i * 4 + 0];
+            row[i * 4 + 1] = ~row[i * 4 + 1];
+            row[i * 4 + 2] = ~row[i * 4 + 2];
+        }
+    }
+
+    //inverts size bytes (pixels of 3 bytes or gray pixels, which have no alpha)
+    inline void invert_bytes(uint8_t *row, size_t size){
+        size_t i = 0;
+    #ifdef sbtmp_has_sse2
+        const __m128i mask = _mm_set1_epi8(-1);
+        for(; i + 64 <= size; i += 64){
+            for(size_t j = 0; j < 64; j += 16){
+                __m128i *ptr = (__m128i*)(row + i + j);
+                _mm_storeu_si128(ptr, _mm_xor_si128(_mm_loadu_si128(ptr), mask));
+            }
+        }
+    #endif
+        for(; i < size; i++){
+            row[i] = ~row[i];
+        }
+    }
+
+    //the reverse kernels mirror a row in place (the first pixel becomes the last), the bytes inside a pixel stay in order
+    //a vector from the front and one from the back are swapped per iteration, the rest in the middle is done pixel by pixel
+
+    //reverses count pixels of 1 byte
+    inline void reverse1(uint8_t *row, size_t count){
+        size_t i = 0, j = count;
+    #ifdef sbtmp_has_sse2
+        for(; i + 32 <= j; i += 16, j -= 16){
+            __m128i a = _mm_loadu_si128((__m128i*)(row + i)), b = _mm_loadu_si128((__m128i*)(row + j - 16));
+        #ifdef sbtmp_has_ssse3
+            const __m128i mask = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            a = _mm_shuffle_epi8(a, mask);
+            b = _mm_shuffle_epi8(b, mask);
+        #else
+            //reverse the 16 bit words, then swap the bytes inside them
+            a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(_mm_shuffle_epi32(a, 0x1b), 0xb1), 0xb1);
+            b = _mm_shufflehi_epi16(_mm_shufflelo_epi16(_mm_shuffle_epi32(b, 0x1b), 0xb1), 0xb1);
+            a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+            b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+        #endif
+            _mm_storeu_si128((__m128i*)(row + i), b);
+            _mm_storeu_si128((__m128i*)(row + j - 16), a);
+        }
+    #endif
+        for(; i + 1 < j; i++, j--){
+            uint8_t tmp = row[i];
+            row[i] = row[j - 1];
+            row[j - 1] = tmp;
+        }
+    }
+
+    //reverses count pixels of 2 bytes
+    inline void reverse2(uint8_t *row, size_t count){
+        size_t i = 0, j = count;
+    #ifdef sbtmp_has_sse2
+        for(; i + 16 <= j; i += 8, j -= 8){
+            __m128i a = _mm_loadu_si128((__m128i*)(row + i * 2)), b = _mm_loadu_si128((__m128i*)(row + (j - 8) * 2));
+            a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(_mm_shuffle_epi32(a, 0x1b), 0xb1), 0xb1);
+            b = _mm_shufflehi_epi16(_mm_shufflelo_epi16(_mm_shuffle_epi32(b, 0x1b), 0xb1), 0xb1);
+            _mm_storeu_si128((__m128i*)(row + i * 2), b);
+            _mm_storeu_si128((__m128i*)(row + (j - 8) * 2), a);
+        }
+    #endif
+        for(; i + 1 < j; i++, j--){
+            uint16_t a, b;
+            memcpy(&a, row + i * 2, 2);
+            memcpy(&b, row + (j - 1) * 2, 2);
+            memcpy(row + i * 2, &b, 2);
+            memcpy(row + (j - 1) * 2, &a, 2);
+        }
+    }
+
+    //reverses count pixels of 3 bytes
+    //a vector holds 5 pixels and 1 byte of the next one, the vectors are only swapped while there is at least
+    //one pixel between them, so that extra byte always belongs to a pixel that isn't done yet
+    inline void reverse3(uint8_t *row, size_t count){
+        size_t i = 0, j = count;
+    #ifdef sbtmp_has_ssse3
+        //a is loaded at pixel i (extra byte at the end), b one byte before pixel j - 5 (extra byte at the start)
+        const __m128i from_b = _mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, 1, 2, 3, -128);
+        const __m128i from_a = _mm_setr_epi8(-128, 12, 13, 14, 9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2);
+        const __m128i last = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1);
+        const __m128i first = _mm_setr_epi8(-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        for(; i + 11 <= j; i += 5, j -= 5){
+            __m128i a = _mm_loadu_si128((__m128i*)(row + i * 3)), b = _mm_loadu_si128((__m128i*)(row + (j - 5) * 3 - 1));
+            _mm_storeu_si128((__m128i*)(row + i * 3), _mm_or_si128(_mm_shuffle_epi8(b, from_b), _mm_and_si128(a, last)));
+            _mm_storeu_si128((__m128i*)(row + (j - 5) * 3 - 1), _mm_or_si128(_mm_shuffle_epi8(a, from_a), _mm_and_si128(b, first)));
+        }
+    #endif
+        for(; i + 1 < j; i++, j--){
+            uint8_t tmp[3];
+            memcpy(tmp, row + i * 3, 3);
+            memcpy(row + i * 3, row + (j - 1) * 3, 3);
+            memcpy(row + (j - 1) * 3, tmp, 3);
+        }
+    }
+
+    //reverses count pixels of 4 bytes
+    inline void reverse4(uint8_t *row, size_t count){
+        size_t i = 0, j = count;
+    #ifdef sbtmp_has_sse2
+        for(; i + 8 <= j; i += 4, j -= 4){
+            __m128i a = _mm_loadu_si128((__m128i*)(row + i * 4)), b = _mm_loadu_si128((__m128i*)(row + (j - 4) * 4));
+            _mm_storeu_si128((__m128i*)(row + i * 4), _mm_shuffle_epi32(b, 0x1b));
+            _mm_storeu_si128((__m128i*)(row + (j - 4) * 4), _mm_shuffle_epi32(a, 0x1b));
+        }
+    #endif
+        for(; i + 1 < j; i++, j--){
+            uint32_t a, b;
+            memcpy(&a, row + i * 4, 4);
+            memcpy(&b, row + (j - 1) * 4, 4);
+            memcpy(row + i * 4, &b, 4);
+            memcpy(row + (j - 1) * 4, &a, 4);
+        }
+    }
+
+    //reverses count pixels of bytes_per_pixel (1 to 4) bytes
+    inline void reverse(uint8_t *row, uint8_t bytes_per_pixel, size_t count){
+        switch(bytes_per_pixel){
+            case 1: reverse1(row, count); break;
+            case 2: reverse2(row, count); break;
+            case 3: reverse3(row, count); break;
+            case 4: reverse4(row, count); break;
+            default: break;
+        }
+    }
+
+    //swaps size bytes of a and b (two rows), in blocks that fit into the L1 cache
+    inline void swap_bytes(uint8_t *a, uint8_t *b, size_t size){
+        uint8_t buffer[4096];
+        for(size_t i = 0; i < size; i += sizeof(buffer)){
+            size_t n = size - i < sizeof(buffer) ? size - i : sizeof(buffer);
+            memcpy(buffer, a + i, n);
+            memcpy(a + i, b + i, n);
+            memcpy(b + i, buffer, n);
+        }
+    }
+
+    //plain version of shuffle_pixels for pixels first to count - 1, the map is kept in local variables and the pixel
+    //sizes are constants, so the compiler can keep everything in registers (dst could overlap map otherwise)
+    //a source pixel is completely read before it is written, so src and dst may be the same
+    template<uint8_t SrcBytes, uint8_t DstBytes>
+    inline void shuffle_pixels(const uint8_t *src, uint8_t *dst, const uint8_t map[4], uint8_t alpha, size_t first, size_t count){
+        //the alpha goes into byte 4 of the source pixel copy, so 0xff doesn't need a branch
+        uint8_t m0 = map[0] == 0xff ? 4 : map[0], m1 = map[1] == 0xff ? 4 : map[1], m2 = map[2] == 0xff ? 4 : map[2], m3 = map[3] == 0xff ? 4 : map[3];
+        for(size_t i = first; i < count; i++){
+            uint8_t pixel[5];
+            memcpy(pixel, src + i * SrcBytes, SrcBytes);
+            pixel[4] = alpha;
+            uint8_t *out = dst + i * DstBytes;
+            out[0] = pixel[m0];
+            out[1] = pixel[m1];
+            out[2] = pixel[m2];
+            if constexpr(DstBytes == 4)
+                out[3] = pixel[m3];
+        }
+    }
+
+    //moves the bytes of count pixels around, for converting between channel orders (BGR, BGRA, RGBA...)
+    //byte n of every dst pixel is byte map[n] of the src pixel, map[n] = 0xff writes alpha instead (for sources without alpha)
+    //src and dst pixels have 3 or 4 bytes, src and dst may be the same buffer if the pixels have the same size
+    //16 pixels per iteration with SSSE3: the pixels are loaded 4 per vector, moved with one pshufb per vector and stored
+    inline void shuffle_pixels(const uint8_t *src, uint8_t src_bytes, uint8_t *dst, uint8_t dst_bytes, const uint8_t map[4], uint8_t alpha, size_t count){
+        size_t i = 0;
+    #ifdef sbtmp_has_ssse3
+        //pshufb mask for 4 pixels, bytes with the high bit set become 0 and get the alpha from fill
+        alignas(16) uint8_t mask_bytes[16], fill_bytes[16] = {0};
+        memset(mask_bytes, 0x80, sizeof(mask_bytes));
+        for(uint8_t p = 0; p < 4; p++){
+            for(uint8_t n = 0; n < dst_bytes; n++){
+                if(map[n] == 0xff)
+                    fill_bytes[p * dst_bytes + n] = alpha;
+                else
+                    mask_bytes[p * dst_bytes + n] = p * src_bytes + map[n];
+            }
+        }
+        const __m128i mask = _mm_load_si128((const __m128i*)mask_bytes), fill = _mm_load_si128((const __m128i*)fill_bytes);
+        for(; i + 16 <= count; i += 16){
+            const uint8_t *in = src + i * src_bytes;
+            uint8_t *out = dst + i * dst_bytes;
+            __m128i v0, v1, v2, v3;
+            if(src_bytes == 4){
+                v0 = _mm_loadu_si128((const __m128i*)(in + 0));
+                v1 = _mm_loadu_si128((const __m128i*)(in + 16));
+                v2 = _mm_loadu_si128((const __m128i*)(in + 32));
+                v3 = _mm_loadu_si128((const __m128i*)(in + 48));
+            }
+            else{
+                //16 pixels of 3 bytes are 3 vectors, every 12 bytes start 4 new pixels
+                __m128i a = _mm_loadu_si128((const __m128i*)(in + 0));
+                __m128i b = _mm_loadu_si128((const __m128i*)(in + 16));
+                __m128i c = _mm_loadu_si128((const __m128i*)(in + 32));
+                v0 = a;
+                v1 = _mm_alignr_epi8(b, a, 12);
+                v2 = _mm_alignr_epi8(c, b, 8);
+                v3 = _mm_srli_si128(c, 4);
+            }
+            v0 = _mm_or_si128(_mm_shuffle_epi8(v0, mask), fill);
+            v1 = _mm_or_si128(_mm_shuffle_epi8(v1, mask), fill);
+            v2 = _mm_or_si128(_mm_shuffle_epi8(v2, mask), fill);
+            v3 = _mm_or_si128(_mm_shuffle_epi8(v3, mask), fill);
+            if(dst_bytes == 4){
+                _mm_storeu_si128((__m128i*)(out + 0), v0);
+                _mm_storeu_si128((__m128i*)(out + 16), v1);
+                _mm_storeu_si128((__m128i*)(out + 32), v2);
+                _mm_storeu_si128((__m128i*)(out + 48), v3);
+            }
+            else{
+                //every vector holds 12 bytes, joined into 3 full vectors
+                _mm_storeu_si128((__m128i*)(out + 0), _mm_or_si128(v0, _mm_slli_si128(v1, 12)));
+                _mm_storeu_si128((__m128i*)(out + 16), _mm_or_si128(_mm_srli_si128(v1, 4), _mm_slli_si128(v2, 8)));
+                _mm_storeu_si128((__m128i*)(out + 32), _mm_or_si128(_mm_srli_si128(v2, 8), _mm_slli_si128(v3, 4)));
+            }
+        }
+    #endif
+        if(src_bytes == 3)
+            dst_bytes == 3 ? shuffle_pixels<3, 3>(src, dst, map, alpha, i, count) : shuffle_pixels<3, 4>(src, dst, map, alpha, i, count);
+        else
+            dst_bytes == 3 ? shuffle_pixels<4, 3>(src, dst, map, alpha, i, count) : shuffle_pixels<4, 4>(src, dst, map, alpha, i, count);
+    }
+}
@@ -0,0 +1,456 @@
+#pragma once
+
+#include "sbtmp2.0_bitmap.hpp"
+
+namespace sbtmp::formats{
+    //32 bit BGRA image stored in square tiles of 64 * 64 pixels (16 KiB each) instead of rows
+    //pixels that are close to each other in 2D are close in memory, so algorithms that walk columns, small blocks
+    //or both directions (flips, rotations, blurs, shapes) stay inside a few tiles and keep them in cache,
+    //where a row layout would load a new cache line for every step down
+    //
+    //the tiles are stored row by row, every tile stores its pixels row by row
+    //images with a size that isn't a multiple of 64 have partial tiles at the right and bottom edge, the unused part is never touched
+    //
+    //there are no rows in memory, so get_row returns nullptr (views forward to set_pixel/get_pixel)
+    //use read_row/write_row or from_image/to_image to convert from and to linear rows
+    //saved files are ordinary Bitmap32 files, saving and loading needs memory for a second copy of the image
+    class Tiled final : public sbtmp::base::image{
+        public:
+
+        //side length of a tile in pixels
+        static constexpr uint32_t tile_size = 64;
+
+        //constructor
+        Tiled(uint32_t set_width, uint32_t set_height) {
+            create(set_width, set_height);
+        }
+
+        //copy constructor
+        //creates a perfect copy of the original image
+        Tiled(const Tiled &other){
+            copy_from(other);
+        }
+
+        //move constructor, takes over the pixel data of the other image and leaves it empty
+        Tiled(Tiled &&other) noexcept{
+            move_from(other);
+        }
+
+        Tiled &operator=(const Tiled &other){
+            if(this != &other){
+                del();
+                copy_from(other);
+            }
+            return *this;
+        }
+
+        Tiled &operator=(Tiled &&other) noexcept{
+            if(this != &other){
+                del();
+                move_from(other);
+            }
+            return *this;
+        }
+
+        Tiled() = default;
+
+        ~Tiled(){
+            del();
+        }
+
+        //saves the image as a Bitmap32 file
+        bool save(const char * filename) override {
+            Bitmap32 linear;
+            return to_image(linear) && linear.save(filename);
+        }
+
+        //loads every *.bmp file Bitmap32 can load
+        bool load(const char * filename) override {
+            if(initialized)
+                return false;
+            Bitmap32 linear;
+            return linear.load(filename) && from_image(linear);
+        }
+
+        //encodes the image as Bitmap32 file into a memory buffer (the old content of the buffer is replaced)
+        bool encode(std::vector<uint8_t> &buffer) override {
+            Bitmap32 linear;
+            return to_image(linear) && linear.encode(buffer);
+        }
+
+        //encodes the image as Bitmap32 file into a caller supplied buffer
+        //returns the number of bytes written or 0 if the buffer is too small
+        size_t encode(uint8_t *buffer, size_t size) override {
+            if(!initialized || size < encoded_size())
+                return 0;
+            Bitmap32 linear;
+            return to_image(linear) ? linear.encode(buffer, size) : 0;
+        }
+
+        //number of bytes a Bitmap32 file of this image has
+        size_t encoded_size() override {
+            return initialized ? 122 + (size_t)btmp_width * btmp_height * 4 : 0;
+        }
+
+        //loads a *.bmp file from a memory buffer
+        bool decode(const uint8_t *buffer, size_t size) override {
+            if(initialized)
+                return false;
+            Bitmap32 linear;
+            return linear.decode(buffer, size) && from_image(linear);
+        }
+        using base::image::decode;
+
+        //create function (recommended way to init images)
+        void create(uint32_t set_width, uint32_t set_height) override {
+            if(initialized)
+                return;
+
+            uint32_t x_tiles = (set_width + tile_size - 1) / tile_size, y_tiles = (set_height + tile_size - 1) / tile_size;
+            size_t size = (size_t)x_tiles * y_tiles * tile_bytes;
+            pixel_data = get_allocator().allocate(size);
+            if(!pixel_data)
+                return;
+
+            btmp_width = set_width;
+            btmp_height = set_height;
+            tiles_x = x_tiles;
+            tiles_y = y_tiles;
+            raw_data_size = size;
+
+            initialized = true;
+        }
+
+        //copies the pixels of another image into this one
+        //an empty tiled image gets the size of src, otherwise both images have to have the same size
+        //BGRA and BGR images are copied row by row, all others pixel by pixel
+        bool from_image(base::image &src){
+            if(!src.is_initialized())
+                return false;
+            if(!initialized)
+                create(src.get_width(), src.get_height());
+            if(!initialized || src.get_width() != btmp_width || src.get_height() != btmp_height)
+                return false;
+
+            base::channel_order order = src.get_channel_order();
+            if(!has_row_access(src, order)){
+                for(uint32_t y = 0; y < btmp_height; y++){
+                    for(uint32_t x = 0; x < btmp_width; x++){
+                        set_pixel_unchecked(x, y, src.get_pixel(x, y));
+                    }
+                }
+                return true;
+            }
+
+            std::vector<uint8_t> bgra_row(order == base::channel_order::bgr ? (size_t)btmp_width * 4 : 0);
+            for(uint32_t y = 0; y < btmp_height; y++){
+                const uint8_t *row = src.get_const_row(y);
+                if(order == base::channel_order::bgr){
+                    for(uint32_t x = 0; x < btmp_width; x++){
+                        bgra_row[x * 4 + 0] = row[x * 3 + 0];
+                        bgra_row[x * 4 + 1] = row[x * 3 + 1];
+                        bgra_row[x * 4 + 2] = row[x * 3 + 2];
+                        bgra_row[x * 4 + 3] = 255;
+                    }
+                    row = bgra_row.data();
+                }
+                write_row(y, row);
+            }
+            return true;
+        }
+
+        //copies the pixels of this image into another one
+        //an empty dst is created with the size of this image, otherwise both images have to have the same size
+        //converted the same way as from_image
+        bool to_image(base::image &dst){
+            if(!initialized)
+                return false;
+            if(!dst.is_initialized())
+                dst.create(btmp_width, btmp_height);
+            if(!dst.is_initialized() || dst.get_width() != btmp_width || dst.get_height() != btmp_height)
+                return false;
+
+            base::channel_order order = dst.get_channel_order();
+            if(!has_row_access(dst, order)){
+                for(uint32_t y = 0; y < btmp_height; y++){
+                    for(uint32_t x = 0; x < btmp_width; x++){
+                        dst.set_pixel(x, y, get_pixel_unchecked(x, y));
+                    }
+                }
+                return true;
+            }
+
+            std::vector<uint8_t> bgra_row(order == base::channel_order::bgr ? (size_t)btmp_width * 4 : 0);
+            for(uint32_t y = 0; y < btmp_height; y++){
+                uint8_t *row = dst.get_row(y);
+                if(order == base::channel_order::bgra){
+                    read_row(y, row);
+                    continue;
+                }
+                read_row(y, bgra_row.data());
+                for(uint32_t x = 0; x < btmp_width; x++){
+                    row[x * 3 + 0] = bgra_row[x * 4 + 0];
+                    row[x * 3 + 1] = bgra_row[x * 4 + 1];
+                    row[x * 3 + 2] = bgra_row[x * 4 + 2];
+                }
+            }
+            return true;
+        }
+
+        //copies row y (y = 0 is the top row) into dst as BGRA pixels, dst needs room for get_width() * 4 bytes
+        //the row is put together from the rows of all tiles it goes through, one memcpy per tile
+        bool read_row(uint32_t y, uint8_t *dst){
+            if(!initialized || y >= btmp_height)
+                return false;
+            for(uint32_t tx = 0; tx < tiles_x; tx++){
+                uint32_t count = std::min(tile_size, btmp_width - tx * tile_size);
+                memcpy(dst + (size_t)tx * tile_size * 4, tile_row(tx, y), count * 4);
+            }
+            return true;
+        }
+
+        //copies BGRA pixels from src into row y, src has to have get_width() * 4 bytes
+        bool write_row(uint32_t y, const uint8_t *src){
+            if(!initialized || y >= btmp_height)
+                return false;
+            for(uint32_t tx = 0; tx < tiles_x; tx++){
+                uint32_t count = std::min(tile_size, btmp_width - tx * tile_size);
+                memcpy(tile_row(tx, y), src + (size_t)tx * tile_size * 4, count * 4);
+            }
+            return true;
+        }
+
+        //returns the first pixel of a tile (tile_size rows of tile_size BGRA pixels), nullptr if there is no such tile
+        //tile tx, ty covers the pixels tx * tile_size, ty * tile_size up to (tx + 1) * tile_size - 1, (ty + 1) * tile_size - 1
+        uint8_t *get_tile(uint32_t tx, uint32_t ty){
+            if(!initialized || tx >= tiles_x || ty >= tiles_y)
+                return nullptr;
+            return pixel_data + ((size_t)ty * tiles_x + tx) * tile_bytes;
+        }
+
+        //returns the number of tiles in a row of tiles
+        uint32_t get_tiles_x(){
+            return tiles_x;
+        }
+
+        //returns the number of rows of tiles
+        uint32_t get_tiles_y(){
+            return tiles_y;
+        }
+
+        //set pixel at coords x, y to rgb value
+        void set_pixel(int32_t x, int32_t y, color::Color col) override {
+            if (!initialized || x > btmp_width - 1 || y > btmp_height - 1 || x < 0 || y < 0)
+                return;
+            set_pixel_unchecked(x, y, col);
+        }
+
+        //get color of pixel at coords x, y
+        color::Color get_pixel(int32_t x, int32_t y) override {
+            return get_pixel_unchecked(x, y);
+        }
+
+        //same as set_pixel and get_pixel, but without checking if the image is initialized and the pixel is inside of it
+        //the graphics and filters templates use these for pixels they already know to be inside the image
+        void set_pixel_unchecked(int32_t x, int32_t y, color::Color col){
+            uint8_t *pixel = pixel_data + get_p_index(x, y);
+            pixel[0] = color::get_blue(col);
+            pixel[1] = color::get_green(col);
+            pixel[2] = color::get_red(col);
+            pixel[3] = color::get_alpha(col);
+        }
+        color::Color get_pixel_unchecked(int32_t x, int32_t y){
+            const uint8_t *pixel = pixel_data + get_p_index(x, y);
+            return color::set_col(pixel[2], pixel[1], pixel[0], pixel[3]);
+        }
+
+        //sets count pixels of row y, starting at x, to one color (pixels outside the image are skipped)
+        void fill_span(int32_t x, int32_t y, uint32_t count, color::Color col) override {
+            int64_t first = std::max<int64_t>(x, 0), last = std::min<int64_t>((int64_t)x + count, btmp_width);
+            if(!initialized || y < 0 || y >= btmp_height || first >= last)
+                return;
+            fill_span_unchecked(first, y, last - first, col);
+        }
+
+        //same as fill_span, but without any checks (see base::fill_span)
+        //the run is filled piece by piece, one piece per tile it goes through
+        void fill_span_unchecked(int32_t x, int32_t y, uint32_t count, color::Color col){
+            uint32_t pixel = color::get_blue(col) | color::get_green(col) << 8 | color::get_red(col) << 16 | (uint32_t)color::get_alpha(col) << 24;
+            while(count){
+                uint32_t piece = std::min(count, tile_size - (x & (tile_size - 1)));
+                simd::fill32(pixel_data + get_p_index(x, y), pixel, piece);
+                x += piece;
+                count -= piece;
+            }
+        }
+
+        //return width of the image
+        uint32_t get_width() override {
+            return btmp_width;
+        }
+
+        //returns height of the image
+        uint32_t get_height() override {
+            return btmp_height;
+        }
+
+        //returns size of the raw data array in bytes
+        size_t get_raw_size() override {
+            return raw_data_size;
+        }
+
+        //changes the size of the image
+        //the picture is kept (cut off or extended with black pixels), the tiles would be mixed up otherwise
+        void resize(uint32_t width, uint32_t height) override {
+            if(!initialized)
+                return;
+            if(width == btmp_width && height == btmp_height) // args are the same size as image
+                return;
+
+            Tiled resized;
+            resized.pixel_allocator = pixel_allocator;
+            resized.create(width, height);
+            if(!resized.initialized) // not enough memory, keep the old image
+                return;
+
+            //copy the overlapping part tile row by tile row
+            uint32_t copy_width = std::min(width, btmp_width), copy_height = std::min(height, btmp_height);
+            for(uint32_t y = 0; y < copy_height; y++){
+                for(uint32_t tx = 0; tx * tile_size < copy_width; tx++){
+                    memcpy(resized.tile_row(tx, y), tile_row(tx, y), std::min(tile_size, copy_width - tx * tile_size) * 4);
+                }
+            }
+            *this = std::move(resized);
+        }
+
+        //clears the image
+        void clear() override {
+            if(!initialized)
+                return;
+            memset(pixel_data, 0, raw_data_size);
+        }
+
+        //frees the memory of the image and resets all properties
+        void del() override {
+            if(!initialized)
+                return;
+
+            get_allocator().deallocate(pixel_data, raw_data_size);
+            pixel_data = nullptr;
+
+            btmp_width = 0;
+            btmp_height = 0;
+            tiles_x = 0;
+            tiles_y = 0;
+            raw_data_size = 0;
+
+            initialized = false;
+        }
+
+        //changes where the image gets its pixel memory from (a memory::buffer_pool for example)
+        //only possible while the image is empty, returns false otherwise
+        //the allocator has to live longer than the image
+        bool set_allocator(memory::allocator &alloc){
+            if(initialized)
+                return false;
+            pixel_allocator = &alloc;
+            return true;
+        }
+
+        //returns the allocator of the image (the default allocator if none was set)
+        memory::allocator &get_allocator(){
+            if(!pixel_allocator)
+                pixel_allocator = &memory::get_default_allocator();
+            return *pixel_allocator;
+        }
+
+        bool is_initialized() override {
+            return initialized;
+        }
+
+        //returns the pixel data (all tiles one after another, see get_tile)
+        uint8_t *data() override {
+            return pixel_data;
+        }
+
+        uint8_t get_bytes_per_pixel() override {
+            return 4;
+        }
+
+
+        private:
+
+        static constexpr uint32_t tile_shift = 6; //tile_size = 1 << tile_shift
+        static constexpr size_t tile_bytes = (size_t)tile_size * tile_size * 4;
+        static_assert(tile_size == 1u << tile_shift);
+
+        //true if the pixels of img can be converted row by row
+        static bool has_row_access(base::image &img, base::channel_order order){
+            if(order == base::channel_order::bgra)
+                return img.get_bytes_per_pixel() == 4 && img.get_const_row(0);
+            if(order == base::channel_order::bgr)
+                return img.get_bytes_per_pixel() == 3 && img.get_const_row(0);
+            return false;
+        }
+
+        //returns the array index of a pixel
+        size_t get_p_index(uint32_t x_pos, uint32_t y_pos){
+            size_t tile = (size_t)(y_pos >> tile_shift) * tiles_x + (x_pos >> tile_shift);
+            return tile * tile_bytes + ((y_pos & (tile_size - 1)) * tile_size + (x_pos & (tile_size - 1))) * 4;
+        }
+
+        //returns the part of row y that lies in tile column tx
+        uint8_t *tile_row(uint32_t tx, uint32_t y){
+            return pixel_data + get_p_index(tx * tile_size, y);
+        }
+
+        //used by the copy constructor and copy assignment, expects this image to be empty
+        void copy_from(const Tiled &other){
+            if(!other.initialized)
+                return;
+            //a copy uses the same allocator as the original, unless it already has one
+            if(!pixel_allocator)
+                pixel_allocator = other.pixel_allocator;
+            pixel_data = get_allocator().allocate(other.raw_data_size);
+            if(!pixel_data)
+                return;
+            memcpy(pixel_data, other.pixel_data, other.raw_data_size);
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            tiles_x = other.tiles_x;
+            tiles_y = other.tiles_y;
+            raw_data_size = other.raw_data_size;
+            initialized = true;
+        }
+
+        //used by the move constructor and move assignment, expects this image to be empty
+        void move_from(Tiled &other){
+            if(!other.initialized)
+                return;
+            pixel_data = other.pixel_data;
+            pixel_allocator = other.pixel_allocator; //the pixel data has to go back to where it came from
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            tiles_x = other.tiles_x;
+            tiles_y = other.tiles_y;
+            raw_data_size = other.raw_data_size;
+            initialized = true;
+
+            other.pixel_data = nullptr;
+            other.btmp_width = 0;
+            other.btmp_height = 0;
+            other.tiles_x = 0;
+            other.tiles_y = 0;
+            other.raw_data_size = 0;
+            other.initialized = false;
+        }
+
+        uint32_t btmp_width = 0, btmp_height = 0;
+        uint32_t tiles_x = 0, tiles_y = 0; //number of tiles in a row of tiles and number of rows of tiles
+        size_t raw_data_size = 0;
+
+        uint8_t * pixel_data = nullptr;
+        memory::allocator *pixel_allocator = nullptr; //where pixel_data comes from, see get_allocator
+        bool initialized = false;
+    };
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "sbtmp2.0_base.hpp"
+
+namespace sbtmp::formats{
+    //a rectangle of another image that can be used like an image of its own
+    //the view doesn't own or copy any pixels, it works directly on the pixel data of its parent
+    //every change made through the view ends up in the parent and the other way around
+    //
+    //views work with all image types, types with row access (see base::image::get_row) are accessed directly,
+    //for every other type the view forwards to the parent's set_pixel/get_pixel
+    //the rows are looked up in the parent on every access and never kept, so a parent that shares its pixels with a copy
+    //(copy on write) gets its own pixels on the first change through the view, and the copy stays untouched
+    //views can be made of views as well
+    //
+    //IMPORTANT: a view becomes invalid if its parent is resized, deleted, destroyed or moved from!
+    //
+    //views can't be saved or loaded, use them to work on a part of an image and save the parent
+    class ImageView final : public base::image{
+        public:
+
+        ImageView() = default;
+
+        //creates a view of the rectangle with the upper left corner x, y and the size width * height
+        ImageView(base::image &parent, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
+            attach(parent, x, y, width, height);
+        }
+
+        //creates a view of the whole image
+        ImageView(base::image &parent){
+            attach(parent, 0, 0, parent.get_width(), parent.get_height());
+        }
+
+        //points the view to a rectangle of an image
+        //returns false (and leaves the view empty) if the rectangle isn't completely inside the image
+        bool attach(base::image &parent, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
+            del();
+            if(!parent.is_initialized() || width == 0 || height == 0 || (uint64_t)x + width > parent.get_width() || (uint64_t)y + height > parent.get_height())
+                return false;
+
+            parent_img = &parent;
+            x_offset = x;
+            y_offset = y;
+            view_width = width;
+            view_height = height;
+
+            //use the pixel data directly if the parent tells us how it is stored
+            //(only read here, the parent's pixels stay shared until something is written through the view)
+            bytes_per_pixel = parent.get_bytes_per_pixel();
+            order = parent.get_channel_order();
+            if(!parent.get_const_row(y) || !bytes_per_pixel || order == base::channel_order::unknown || order == base::channel_order::mono){
+                bytes_per_pixel = 0;
+                order = base::channel_order::unknown;
+            }
+
+            initialized = true;
+            return true;
+        }
+
+        //returns the image the view points into
+        base::image *get_parent(){
+            return parent_img;
+        }
+
+        //returns the position of the view in its parent
+        uint32_t get_x_offset(){
+            return x_offset;
+        }
+
+        uint32_t get_y_offset(){
+            return y_offset;
+        }
+
+        //set pixel at coords x, y (relative to the view) to rgb value
+        void set_pixel(int32_t x, int32_t y, color::Color col) override {
+            if (!initialized || x > view_width - 1 || y > view_height - 1 || x < 0 || y < 0)
+                return;
+            set_pixel_unchecked(x, y, col);
+        }
+
+        //get color of pixel at coords x, y (relative to the view)
+        color::Color get_pixel(int32_t x, int32_t y) override {
+            if (!initialized || x > view_width - 1 || y > view_height - 1 || x < 0 || y < 0)
+                return 0;
+            return get_pixel_unchecked(x, y);
+        }
+
+        //same as set_pixel and get_pixel, but without checking if the view is attached and the pixel is inside of it
+        //the graphics and filters templates use these for pixels they already know to be inside the image
+        void set_pixel_unchecked(int32_t x, int32_t y, color::Color col){
+            if(order == base::channel_order::unknown){
+                parent_img->set_pixel(x_offset + x, y_offset + y, col);
+                return;
+            }
+            uint8_t *pixel = get_row(y);
+            if(!pixel) // the parent couldn't get pixels of its own
+                return;
+            pixel += (size_t)x * bytes_per_pixel;
+            switch(order){
+                case base::channel_order::bgra:
+                    pixel[3] = color::get_alpha(col);
+                    [[fallthrough]];
+                case base::channel_order::bgr:
+                    pixel[0] = color::get_blue(col);
+                    pixel[1] = color::get_green(col);
+                    pixel[2] = color::get_red(col);
+                    break;
+                case base::channel_order::rgba:
+                    pixel[3] = color::get_alpha(col);
+                    [[fallthrough]];
+                case base::channel_order::rgb:
+                    pixel[0] = color::get_red(col);
+                    pixel[1] = color::get_green(col);
+                    pixel[2] = color::get_blue(col);
+                    break;
+                case base::channel_order::gray:
+                    pixel[0] = (color::get_red(col) + color::get_green(col) + color::get_blue(col)) / 3;
+                    break;
+                default:
+                    parent_img->set_pixel(x_offset + x, y_offset + y, col);
+                    break;
+            }
+        }
+        color::Color get_pixel_unchecked(int32_t x, int32_t y){
+            if(order == base::channel_order::unknown)
+                return parent_img->get_pixel(x_offset + x, y_offset + y);
+            const uint8_t *pixel = get_const_row(y) + (size_t)x * bytes_per_pixel;
+            switch(order){
+                case base::channel_order::bgra:
+                    return color::set_col(pixel[2], pixel[1], pixel[0], pixel[3]);
+                case base::channel_order::bgr:
+                    return color::set_col(pixel[2], pixel[1], pixel[0], 255);
+                case base::channel_order::rgba:
+                    return color::set_col(pixel[0], pixel[1], pixel[2], pixel[3]);
+                case base::channel_order::rgb:
+                    return color::set_col(pixel[0], pixel[1], pixel[2], 255);
+                case base::channel_order::gray:
+                    return color::set_col(pixel[0], pixel[0], pixel[0], 255);
+                default:
+                    return parent_img->get_pixel(x_offset + x, y_offset + y);
+            }
+        }
+
+        //sets count pixels of row y (relative to the view), starting at x, to one color (pixels outside the view are skipped)
+        //the parent fills the run, so views of images with SIMD fills get them too
+        void fill_span(int32_t x, int32_t y, uint32_t count, color::Color col) override {
+            int64_t first = std::max<int64_t>(x, 0), last = std::min<int64_t>((int64_t)x + count, view_width);
+            if(!initialized || y < 0 || y >= view_height || first >= last)
+                return;
+            fill_span_unchecked(first, y, last - first, col);
+        }
+        void fill_span_unchecked(int32_t x, int32_t y, uint32_t count, color::Color col){
+            parent_img->fill_span(x_offset + x, y_offset + y, count, col);
+        }
+
+        //return width of the view
+        uint32_t get_width() override {
+            return view_width;
+        }
+
+        //returns height of the view
+        uint32_t get_height() override {
+            return view_height;
+        }
+
+        //sets every pixel of the view to 0
+        void clear() override {
+            if(!initialized)
+                return;
+            if(order == base::channel_order::unknown){
+                for(uint32_t y = 0; y < view_height; y++){
+                    for(uint32_t x = 0; x < view_width; x++){
+                        parent_img->set_pixel(x_offset + x, y_offset + y, 0);
+                    }
+                }
+                return;
+            }
+            for(uint32_t y = 0; y < view_height; y++){
+                uint8_t *row = get_row(y);
+                if(!row) // the parent couldn't get pixels of its own
+                    return;
+                memset(row, 0, get_row_size());
+            }
+        }
+
+        //detaches the view from its parent (the parent is left untouched)
+        void del() override {
+            parent_img = nullptr;
+            x_offset = 0;
+            y_offset = 0;
+            view_width = 0;
+            view_height = 0;
+            bytes_per_pixel = 0;
+            order = base::channel_order::unknown;
+            initialized = false;
+        }
+
+        bool is_initialized() override {
+            return initialized;
+        }
+
+        //returns a pointer to row y of the view (y = 0 is the top row)
+        //nullptr if the parent has no row access
+        uint8_t *get_row(uint32_t y) override {
+            if(!initialized || order == base::channel_order::unknown || y >= view_height)
+                return nullptr;
+            uint8_t *row = parent_img->get_row(y_offset + y);
+            return row ? row + (size_t)x_offset * bytes_per_pixel : nullptr;
+        }
+
+        //same as get_row, but only for reading (see base::image::get_const_row)
+        const uint8_t *get_const_row(uint32_t y) override {
+            if(!initialized || order == base::channel_order::unknown || y >= view_height)
+                return nullptr;
+            const uint8_t *row = parent_img->get_const_row(y_offset + y);
+            return row ? row + (size_t)x_offset * bytes_per_pixel : nullptr;
+        }
+
+        size_t get_row_size() override {
+            return (size_t)view_width * bytes_per_pixel;
+        }
+
+        size_t get_row_stride() override {
+            return order == base::channel_order::unknown ? 0 : parent_img->get_row_stride();
+        }
+
+        uint8_t get_bytes_per_pixel() override {
+            return bytes_per_pixel;
+        }
+
+        base::channel_order get_channel_order() override {
+            return order;
+        }
+
+        bool is_bottom_up() override {
+            return order != base::channel_order::unknown && parent_img->is_bottom_up();
+        }
+
+
+        private:
+
+        base::image *parent_img = nullptr;
+
+        uint32_t x_offset = 0, y_offset = 0;
+        uint32_t view_width = 0, view_height = 0;
+        uint8_t bytes_per_pixel = 0;
+        base::channel_order order = base::channel_order::unknown;
+        bool initialized = false;
+    };
+}
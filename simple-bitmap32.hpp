@@ -1,4 +1,4 @@
-/* very simple bitmap library version exp 0.56
+/* very simple bitmap library version exp 0.59
  * by Erik S.
  * 
  * This library is an improved version of my original bitmap library.
@@ -148,6 +148,15 @@
  * - fixed ring sector drawing function (removed center pixel)
  * - crossed the 2000 line mark. Yay
  * 
+ * 0.58
+ * - fixed memory leak: the destructor never freed the pixel data
+ * - copy constructor takes a const reference and copies with memcpy
+ * - added copy assignment, move constructor and move assignment
+ * 
+ * 0.59
+ * - fixed flip_vertical and flip_horizontal (x and y of the pixel index were swapped, which broke every image that wasn't a square)
+ * - flip_horizontal swaps whole rows with memcpy, flip_vertical swaps whole pixels
+ * 
  * TODO:
  * - improve triangle function (maybe copy from rsbtmp?) (Yes sbtmp exists for Rust. Still WIP and very early though. Has more features than this C++ version though)
  * - add thickness parameter to triangle_border function
@@ -468,21 +477,32 @@ namespace sbtmp{
 
         //copy constructor
         //creates a perfect copy of the original image
-        //it also copies emtpy images by first freeing all data
-        Bitmap(Bitmap &other){
-            initialized = other.initialized;
-            total_size_in_bytes = other.total_size_in_bytes;
-            btmp_width = other.btmp_width;
-            btmp_height = other.btmp_height;
-            raw_data_size = other.raw_data_size;
-            if(pixel_data)
-                free(pixel_data);
-            if(other.pixel_data){
-                pixel_data = (uint8_t*)malloc(raw_data_size);
-                for(uint32_t i = 0; i < raw_data_size; i++){
-                    pixel_data[i] = other.pixel_data[i];
-                }
+        Bitmap(const Bitmap &other){
+            copy_from(other);
+        }
+
+        //move constructor
+        //takes over the pixel data of the other image without copying it, the other image is left empty
+        Bitmap(Bitmap &&other) noexcept{
+            move_from(other);
+        }
+
+        //copy assignment, the old pixel data is freed first
+        Bitmap &operator=(const Bitmap &other){
+            if(this != &other){
+                del();
+                copy_from(other);
+            }
+            return *this;
+        }
+
+        //move assignment, the old pixel data is freed first
+        Bitmap &operator=(Bitmap &&other) noexcept{
+            if(this != &other){
+                del();
+                move_from(other);
             }
+            return *this;
         }
 
         //allows not using the constructor
@@ -491,8 +511,7 @@ namespace sbtmp{
         //destructor
         ~Bitmap(){
             // free data to prevent memory leak
-            if(!pixel_data)
-                free(pixel_data);
+            del();
         }
 
         //create function (recommended way to init images)
@@ -1605,12 +1624,14 @@ namespace sbtmp{
             if(!initialized)
                 return;
             for(uint32_t i = 0; i < btmp_height; i++){
+                //a row is stored in one piece, so the pixels are swapped as whole 4 byte values
+                uint8_t *row = pixel_data + get_index(0, i);
                 for(uint32_t j = 0; j < btmp_width / 2; j++){
-                    //this is magic
-                    std::swap(pixel_data[get_index(i, j)], pixel_data[get_index(i, btmp_width - j - 1)]);
-                    std::swap(pixel_data[get_index(i, j)+1], pixel_data[get_index(i, btmp_width - j - 1)+1]);
-                    std::swap(pixel_data[get_index(i, j)+2], pixel_data[get_index(i, btmp_width - j - 1)+2]);
-                    std::swap(pixel_data[get_index(i, j)+3], pixel_data[get_index(i, btmp_width - j - 1)+3]);
+                    uint32_t left, right;
+                    memcpy(&left, row + j * 4, 4);
+                    memcpy(&right, row + (btmp_width - j - 1) * 4, 4);
+                    memcpy(row + j * 4, &right, 4);
+                    memcpy(row + (btmp_width - j - 1) * 4, &left, 4);
                 }
             }
         }
@@ -1619,13 +1640,16 @@ namespace sbtmp{
         void flip_horizontal(){
             if(!initialized)
                 return;
+            //whole rows are swapped, through a small buffer
+            uint8_t buffer[4096];
+            size_t row_size = (size_t)btmp_width * 4;
             for(uint32_t i = 0; i < btmp_height / 2; i++){
-                for(uint32_t j = 0; j < btmp_width; j++){
-                    //this is magic too
-                    std::swap(pixel_data[get_index(i, j)], pixel_data[get_index(btmp_height - i - 1, j)]);
-                    std::swap(pixel_data[get_index(i, j)+1], pixel_data[get_index(btmp_height - i - 1, j)+1]);
-                    std::swap(pixel_data[get_index(i, j)+2], pixel_data[get_index(btmp_height - i - 1, j)+2]);
-                    std::swap(pixel_data[get_index(i, j)+3], pixel_data[get_index(btmp_height - i - 1, j)+3]);
+                uint8_t *top = pixel_data + get_index(0, i), *bottom = pixel_data + get_index(0, btmp_height - i - 1);
+                for(size_t j = 0; j < row_size; j += sizeof(buffer)){
+                    size_t n = std::min(sizeof(buffer), row_size - j);
+                    memcpy(buffer, top + j, n);
+                    memcpy(top + j, bottom + j, n);
+                    memcpy(bottom + j, buffer, n);
                 }
             }
         }
@@ -1864,6 +1888,7 @@ namespace sbtmp{
 
             //pixel_data = (uint8_t*)realloc(pixel_data, 0); //what is this shit?
             free(pixel_data); // much better
+            pixel_data = nullptr;
 
             // image is not initialized anymore and can be reinitialized
             initialized = false;
@@ -2037,6 +2062,40 @@ namespace sbtmp{
         uint8_t * pixel_data = nullptr; //is this the same as above? (future me: It is better. The above is total junk)
         bool initialized = false;
 
+        //used by the copy constructor and copy assignment, expects this image to be empty
+        void copy_from(const Bitmap &other){
+            if(!other.initialized)
+                return;
+            pixel_data = (uint8_t*)malloc(other.raw_data_size);
+            if(!pixel_data)
+                return;
+            memcpy(pixel_data, other.pixel_data, other.raw_data_size);
+            total_size_in_bytes = other.total_size_in_bytes;
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            raw_data_size = other.raw_data_size;
+            initialized = true;
+        }
+
+        //used by the move constructor and move assignment, expects this image to be empty
+        void move_from(Bitmap &other){
+            if(!other.initialized)
+                return;
+            pixel_data = other.pixel_data;
+            total_size_in_bytes = other.total_size_in_bytes;
+            btmp_width = other.btmp_width;
+            btmp_height = other.btmp_height;
+            raw_data_size = other.raw_data_size;
+            initialized = true;
+
+            other.pixel_data = nullptr;
+            other.total_size_in_bytes = 0;
+            other.btmp_width = 0;
+            other.btmp_height = 0;
+            other.raw_data_size = 0;
+            other.initialized = false;
+        }
+
         //function used to get the array index of any pixel
         uint64_t get_index(uint32_t x_pos, uint32_t y_pos){
             return ((btmp_height - y_pos - 1) * btmp_width + x_pos) * 4; //y_pos is inverted because of the way the image is stored